@@ -0,0 +1,502 @@
+//
+// Created on 19/10/2026.
+//
+
+#include <string.h>
+
+#include "batch.h"
+#include "simulation.h"
+
+
+// What a slot of the window is to the inhabitant in the middle
+// Near is next door, where children go and as far as slugs and lettuce see
+#define SLOT_NEAR 1
+#define SLOT_FAR 2
+
+
+/**
+ * Whether two configs have the same rules, so their gardens can share a batch
+ * @param a A config
+ * @param b Another config
+ * @return If every rule is the same
+ */
+static bool same_rules(const CONFIG * a, const CONFIG * b) {
+
+    return a->LETTUCE_GROW_PROB == b->LETTUCE_GROW_PROB &&
+           a->SLUG_REPRODUCE_PROB == b->SLUG_REPRODUCE_PROB &&
+           a->FROG_REPRODUCE_PROB == b->FROG_REPRODUCE_PROB &&
+           a->SLUG_MATURE_AGE == b->SLUG_MATURE_AGE &&
+           a->FROG_MATURE_AGE == b->FROG_MATURE_AGE &&
+           a->SLUG_LIFESPAN == b->SLUG_LIFESPAN &&
+           a->FROG_LIFESPAN == b->FROG_LIFESPAN &&
+           a->FROG_HUNGRY == b->FROG_HUNGRY &&
+           a->FROG_VISION_DISTANCE == b->FROG_VISION_DISTANCE;
+
+}
+
+
+/**
+ * Find the position a step away from another, the way sim_wrap would
+ * @param batch The batch
+ * @param x The row
+ * @param y The column
+ * @return The position, -1 if it is off a garden that doesn't wrap
+ */
+static int batch_position(const garden_batch * batch, int x, int y) {
+
+    if (batch->wrap) {
+        x = (x % batch->x + batch->x) % batch->x;
+        y = (y % batch->y + batch->y) % batch->y;
+    } else if (x < 0 || x >= batch->x || y < 0 || y >= batch->y) {
+        return -1;
+    }
+
+    return x * batch->y + y;
+
+}
+
+
+/**
+ * Work out the window around every position
+ * The slots are the cells sim_scan looks at, so a garden that wraps and is smaller than
+ * the window only has each cell once, and distances are the short way round
+ * @param batch The batch
+ */
+static void batch_window(garden_batch * batch) {
+
+    int vision = batch->config->FROG_VISION_DISTANCE;
+    int reach = vision > 1 ? vision : 1;
+
+    int x_span = 2 * reach + 1;
+    int y_span = 2 * reach + 1;
+    if (batch->wrap && x_span > batch->x) x_span = batch->x;
+    if (batch->wrap && y_span > batch->y) y_span = batch->y;
+
+    int * offsets = malloc((size_t) x_span * (size_t) y_span * 2 * sizeof(int));
+    batch->slot_kind = malloc((size_t) x_span * (size_t) y_span);
+    batch->slots = 0;
+
+    for (int i = 0; i < x_span; i++) {
+        int dx = abs(i - reach);
+        if (batch->wrap && batch->x - dx < dx) dx = batch->x - dx;
+
+        for (int j = 0; j < y_span; j++) {
+            int dy = abs(j - reach);
+            if (batch->wrap && batch->y - dy < dy) dy = batch->y - dy;
+            if (!dx && !dy) continue;
+
+            unsigned char kind = 0;
+            if (dx <= 1 && dy <= 1) kind |= SLOT_NEAR;
+            if (dx <= vision && dy <= vision) kind |= SLOT_FAR;
+            if (!kind) continue;
+
+            offsets[2 * batch->slots] = i - reach;
+            offsets[2 * batch->slots + 1] = j - reach;
+            batch->slot_kind[batch->slots++] = kind;
+        }
+    }
+
+    int positions = batch->x * batch->y;
+    batch->neighbour = malloc((size_t) positions * (size_t) batch->slots * sizeof(int));
+    batch->step = malloc((size_t) positions * 4 * sizeof(int));
+
+    for (int x = 0; x < batch->x; x++)
+        for (int y = 0; y < batch->y; y++) {
+            int p = x * batch->y + y;
+
+            for (int s = 0; s < batch->slots; s++)
+                batch->neighbour[p * batch->slots + s] = batch_position(batch, x + offsets[2 * s], y + offsets[2 * s + 1]);
+
+            // In the order of the DIRECTION bits
+            batch->step[p * 4] = batch_position(batch, x - 1, y);
+            batch->step[p * 4 + 1] = batch_position(batch, x, y + 1);
+            batch->step[p * 4 + 2] = batch_position(batch, x + 1, y);
+            batch->step[p * 4 + 3] = batch_position(batch, x, y - 1);
+        }
+
+    free(offsets);
+
+}
+
+
+/**
+ * Put some simulations side by side in a batch
+ * They have to be dense, in memory, the same size, at the same round and have the same rules
+ * Each keeps its own random numbers, which are handed back by batch_unpack
+ * @param sims The simulations
+ * @param count How many, up to BATCH_LANES
+ * @return The batch, NULL if the simulations can't share one
+ */
+garden_batch * batch_create(simulation ** sims, const int count) {
+
+    if (count < 1 || count > BATCH_LANES) return NULL;
+
+    simulation * first = sims[0];
+    for (int n = 0; n < count; n++) {
+        simulation * sim = sims[n];
+        if (sim->garden == NULL || sim->file != NULL || sim->series != NULL || sim->heatmap != NULL ||
+            sim->clusters != NULL)
+            return NULL;
+        if (sim->x != first->x || sim->y != first->y || sim->wrap != first->wrap) return NULL;
+        if (sim->round != first->round || !same_rules(sim->config, first->config)) return NULL;
+    }
+
+    garden_batch * out = malloc(sizeof(garden_batch));
+
+    out->x = first->x;
+    out->y = first->y;
+    out->wrap = first->wrap;
+    out->count = count;
+    out->round = first->round;
+    out->config = first->config;
+
+    int positions = out->x * out->y;
+    out->cells = calloc((size_t) positions * BATCH_LANES, sizeof(cell));
+
+    cell * rows = malloc((size_t) positions * sizeof(cell));
+    for (int l = 0; l < count; l++) {
+        sim_get_rows(sims[l], 0, out->x, rows);
+        for (int p = 0; p < positions; p++) out->cells[(size_t) p * BATCH_LANES + l] = rows[p];
+
+        out->rng[l] = sims[l]->rng;
+        out->lettuce_grow[l] = sims[l]->lettuce_grow;
+        out->slug_reproduce[l] = sims[l]->slug_reproduce;
+        out->frog_reproduce[l] = sims[l]->frog_reproduce;
+    }
+    free(rows);
+
+    batch_window(out);
+
+    return out;
+
+}
+
+
+/**
+ * Move the slugs that are moving in every lane the way move_s does
+ * Every lane looks one step each way from the same position, so whether each way is free
+ * is worked out for every lane at once. A slug that can't carry on the way it was going
+ * picks a free way with its own lane's random numbers, and every lane then writes its
+ * slug to the way it went, one masked write for each way
+ * @param batch The batch
+ * @param p The position of the slugs
+ * @param self The cell at p in every lane
+ * @param moving All ones in the lanes whose slug moves
+ * @param here Set to what is left at p in the moving lanes, the rest are left alone
+ */
+static void batch_move_slugs(garden_batch * batch, const int p, const cell self[BATCH_LANES],
+                             const uint32_t moving[BATCH_LANES], cell here[BATCH_LANES]) {
+
+    const int * step = batch->step + p * 4;
+    cell * cells = batch->cells;
+
+    uint32_t legal[BATCH_LANES];
+    uint32_t way[BATCH_LANES];
+    uint32_t turn[BATCH_LANES];
+
+    for (int l = 0; l < BATCH_LANES; l++) legal[l] = 0;
+    for (int d = 0; d < 4; d++) {
+        if (step[d] < 0) continue;
+        const cell * there = cells + (size_t) step[d] * BATCH_LANES;
+        for (int l = 0; l < BATCH_LANES; l++) legal[l] |= (there[l] == CELL_EMPTY) << d;
+    }
+
+    // Carry on the same way if it can, otherwise the lane needs a new way
+    for (int l = 0; l < BATCH_LANES; l++) {
+        way[l] = self[l] >> CELL_MOVE_SHIFT & CELL_MOVE_MASK & legal[l] & moving[l];
+        turn[l] = moving[l] & (way[l] ? 0 : ~0u) & (legal[l] ? ~0u : 0);
+    }
+
+    for (int l = 0; l < BATCH_LANES; l++)
+        if (turn[l]) way[l] = (uint32_t) pick_random_bit(&batch->rng[l], (int) legal[l]);
+
+    for (int d = 0; d < 4; d++) {
+        if (step[d] < 0) continue;
+        cell * there = cells + (size_t) step[d] * BATCH_LANES;
+        for (int l = 0; l < BATCH_LANES; l++) {
+            uint32_t go = way[l] == 1u << d ? ~0u : 0;
+            cell moved = (self[l] & ~((cell) CELL_MOVE_MASK << CELL_MOVE_SHIFT)) | way[l] << CELL_MOVE_SHIFT |
+                         CELL_ACTIONED;
+            there[l] = (there[l] & ~go) | (moved & go);
+        }
+    }
+
+    // Slugs with nowhere to go stop where they are
+    for (int l = 0; l < BATCH_LANES; l++) {
+        cell stuck = (self[l] & ~((cell) CELL_MOVE_MASK << CELL_MOVE_SHIFT)) | CELL_ACTIONED;
+        cell left = way[l] ? CELL_EMPTY : stuck;
+        here[l] = (here[l] & ~moving[l]) | (left & moving[l]);
+    }
+
+}
+
+
+/**
+ * Take the turns of whatever is at a position in every lane
+ * Does what inhabitant_action does, for each lane's inhabitant. The window is looked over
+ * for every lane at once, counting what each can eat, mate with and move or breed into.
+ * Each lane rolls its own random numbers, and from the rolls and counts what every lane
+ * does is worked out at once as masks. A second look over the window counts each lane down
+ * to the cell it picked, and writes to it there with a masked write, so no lane writes
+ * anywhere on its own
+ * @param batch The batch
+ * @param p The position
+ */
+static void batch_turns(garden_batch * batch, const int p) {
+
+    const CONFIG * config = batch->config;
+    cell * cells = batch->cells;
+    cell * here = cells + (size_t) p * BATCH_LANES;
+    const int * around = batch->neighbour + (size_t) p * batch->slots;
+
+    cell self[BATCH_LANES];
+    uint32_t code[BATCH_LANES];
+    uint32_t food[BATCH_LANES];
+    uint32_t mature[BATCH_LANES];
+    uint32_t frog[BATCH_LANES];
+    uint32_t roam[BATCH_LANES];
+    uint32_t live[BATCH_LANES];
+
+    uint32_t food_count[BATCH_LANES];
+    uint32_t mate_count[BATCH_LANES];
+    uint32_t space_count[BATCH_LANES];
+    uint32_t roam_count[BATCH_LANES];
+
+    // All ones in the lanes that are frogs, hungry frogs, or yet to take their turn
+    for (int l = 0; l < BATCH_LANES; l++) {
+        self[l] = here[l];
+        code[l] = self[l] & CELL_TYPE_MASK;
+        food[l] = code[l] + 1;
+        frog[l] = code[l] == FROG + 1 ? ~0u : 0;
+        mature[l] = code[l] == FROG + 1 ? (uint32_t) config->FROG_MATURE_AGE
+                  : code[l] == SLUG + 1 ? (uint32_t) config->SLUG_MATURE_AGE : CELL_AGE_MAX + 2;
+        roam[l] = frog[l] & ((self[l] >> CELL_HUNGER_SHIFT & CELL_HUNGER_MAX) >= (uint32_t) config->FROG_HUNGRY ? ~0u : 0);
+        live[l] = code[l] && !(self[l] & CELL_ACTIONED) ? ~0u : 0;
+
+        food_count[l] = 0;
+        mate_count[l] = 0;
+        space_count[l] = 0;
+        roam_count[l] = 0;
+    }
+
+    for (int s = 0; s < batch->slots; s++) {
+        if (around[s] < 0) continue;
+
+        const cell * there = cells + (size_t) around[s] * BATCH_LANES;
+        uint32_t near = batch->slot_kind[s] & SLOT_NEAR ? ~0u : 0;
+        uint32_t far = batch->slot_kind[s] & SLOT_FAR ? ~0u : 0;
+
+        for (int l = 0; l < BATCH_LANES; l++) {
+            cell c = there[l];
+            uint32_t seen = (frog[l] & far) | (~frog[l] & near);
+            uint32_t empty = c == CELL_EMPTY ? ~0u : 0;
+            uint32_t type = c & CELL_TYPE_MASK;
+            // Mates that have already had their turn this round are a round older than their cell says
+            uint32_t age = (c >> CELL_AGE_SHIFT & CELL_AGE_MAX) + ((c & (CELL_ACTIONED | CELL_NEWBORN)) == CELL_ACTIONED);
+
+            space_count[l] += empty & near & 1;
+            roam_count[l] += empty & roam[l] & seen & 1;
+            food_count[l] += (type == food[l]) & seen;
+            mate_count[l] += (type == code[l] && age >= mature[l]) & seen;
+        }
+    }
+
+    // Lettuce roll to grow and the others to breed, from each lane's own random numbers
+    uint32_t roll[BATCH_LANES];
+    for (int l = 0; l < BATCH_LANES; l++) {
+        random_generator * rng = &batch->rng[l];
+        roll[l] = 0;
+        if (!live[l]) continue;
+
+        bool yes = code[l] == LETTUCE + 1 ? skip_roll(rng, &batch->lettuce_grow[l], config->LETTUCE_GROW_PROB)
+                 : code[l] == SLUG + 1 ? skip_roll(rng, &batch->slug_reproduce[l], config->SLUG_REPRODUCE_PROB)
+                 : skip_roll(rng, &batch->frog_reproduce[l], config->FROG_REPRODUCE_PROB);
+        roll[l] = yes ? ~0u : 0;
+    }
+
+    // What each lane does, eating before breeding before moving, as inhabitant_action does
+    uint32_t eat[BATCH_LANES];
+    uint32_t breed[BATCH_LANES];
+    uint32_t wander[BATCH_LANES];
+    uint32_t slug_move[BATCH_LANES];
+    uint32_t count[BATCH_LANES];
+
+    for (int l = 0; l < BATCH_LANES; l++) {
+        uint32_t lettuce = code[l] == LETTUCE + 1 ? ~0u : 0;
+        uint32_t slug = code[l] == SLUG + 1 ? ~0u : 0;
+        uint32_t grown = (self[l] >> CELL_AGE_SHIFT & CELL_AGE_MAX) >= mature[l] ? ~0u : 0;
+        uint32_t has_food = food_count[l] ? ~0u : 0;
+        uint32_t has_mate = mate_count[l] ? ~0u : 0;
+        uint32_t has_space = space_count[l] ? ~0u : 0;
+        uint32_t has_roam = roam_count[l] ? ~0u : 0;
+
+        eat[l] = live[l] & ~lettuce & has_food;
+        breed[l] = live[l] & roll[l] & has_space & (lettuce | (~eat[l] & grown & has_mate));
+        slug_move[l] = live[l] & slug & ~eat[l] & ~breed[l];
+        wander[l] = live[l] & frog[l] & roam[l] & has_roam & ~eat[l] & ~breed[l];
+
+        count[l] = (eat[l] & food_count[l]) | (breed[l] & space_count[l]) | (wander[l] & roam_count[l]);
+    }
+
+    // Which of the cells it found each lane picks, -1 for lanes that don't pick one
+    int32_t pick[BATCH_LANES];
+    uint32_t picking = 0;
+    uint32_t moving = 0;
+    for (int l = 0; l < BATCH_LANES; l++) {
+        pick[l] = count[l] ? dice_roll(&batch->rng[l], (int) count[l]) : -1;
+        picking |= count[l];
+        moving |= slug_move[l];
+    }
+
+    // What goes into the picked cell, the inhabitant itself or a child that does nothing this round
+    cell moved[BATCH_LANES];
+    for (int l = 0; l < BATCH_LANES; l++)
+        moved[l] = ((eat[l] | wander[l]) & (self[l] | CELL_ACTIONED)) |
+                   (breed[l] & (code[l] | CELL_ACTIONED | CELL_NEWBORN));
+
+    // Count down to the picked cell in each lane, and write to it when it is reached
+    for (int s = 0; picking && s < batch->slots; s++) {
+        if (around[s] < 0) continue;
+
+        cell * there = cells + (size_t) around[s] * BATCH_LANES;
+        uint32_t near = batch->slot_kind[s] & SLOT_NEAR ? ~0u : 0;
+        uint32_t far = batch->slot_kind[s] & SLOT_FAR ? ~0u : 0;
+
+        for (int l = 0; l < BATCH_LANES; l++) {
+            cell c = there[l];
+            uint32_t seen = (frog[l] & far) | (~frog[l] & near);
+            uint32_t empty = c == CELL_EMPTY ? ~0u : 0;
+            uint32_t type = c & CELL_TYPE_MASK;
+
+            uint32_t found = (eat[l] & (type == food[l] ? ~0u : 0) & seen) | (breed[l] & empty & near) |
+                             (wander[l] & empty & seen);
+            uint32_t hit = found & (pick[l] == 0 ? ~0u : 0);
+
+            there[l] = (c & ~hit) | (moved[l] & hit);
+            pick[l] -= (int32_t) (found & 1);
+        }
+    }
+
+    // What is left behind: nothing once it has moved, itself having had its turn otherwise,
+    // and a frog that has bred is no longer hungry
+    cell left[BATCH_LANES];
+    for (int l = 0; l < BATCH_LANES; l++) {
+        uint32_t gone = eat[l] | wander[l];
+        cell fed = self[l] & ~(breed[l] & frog[l] & ((cell) CELL_HUNGER_MAX << CELL_HUNGER_SHIFT));
+        left[l] = (~gone & live[l] & (fed | CELL_ACTIONED)) | (~live[l] & self[l]);
+    }
+
+    if (moving) batch_move_slugs(batch, p, self, slug_move, left);
+
+    for (int l = 0; l < BATCH_LANES; l++) here[l] = left[l];
+
+}
+
+
+/**
+ * Run a round of every garden in a batch
+ * Positions are taken in row-major order, as garden_round does, then everything is aged
+ * and anything past its lifespan dies, as sim_settle does
+ * @param batch The batch
+ */
+void batch_round(garden_batch * batch) {
+
+    int positions = batch->x * batch->y;
+
+    for (int p = 0; p < positions; p++) {
+        const cell * here = batch->cells + (size_t) p * BATCH_LANES;
+
+        // Only worth a look if some lane has something there that hasn't had its turn
+        uint32_t waiting = 0;
+        for (int l = 0; l < BATCH_LANES; l++)
+            waiting |= (here[l] & CELL_TYPE_MASK) && !(here[l] & CELL_ACTIONED);
+
+        if (waiting) batch_turns(batch, p);
+    }
+
+    uint32_t slug_lifespan = (uint32_t) batch->config->SLUG_LIFESPAN;
+    uint32_t frog_lifespan = (uint32_t) batch->config->FROG_LIFESPAN;
+
+    // The same as cell_settle and cell_dies, for every cell at once
+    for (size_t n = 0; n < (size_t) positions * BATCH_LANES; n++) {
+        cell c = batch->cells[n];
+
+        uint32_t ages = (c & (CELL_ACTIONED | CELL_NEWBORN)) == CELL_ACTIONED;
+        c += (ages & ((c >> CELL_AGE_SHIFT & CELL_AGE_MAX) != CELL_AGE_MAX)) << CELL_AGE_SHIFT;
+        c += (ages & ((c >> CELL_HUNGER_SHIFT & CELL_HUNGER_MAX) != CELL_HUNGER_MAX)) << CELL_HUNGER_SHIFT;
+        c &= ~(CELL_ACTIONED | CELL_NEWBORN);
+
+        uint32_t age = c >> CELL_AGE_SHIFT & CELL_AGE_MAX;
+        uint32_t type = c & CELL_TYPE_MASK;
+        bool dies = (type == SLUG + 1 && age > slug_lifespan) || (type == FROG + 1 && age > frog_lifespan);
+
+        batch->cells[n] = dies ? CELL_EMPTY : c;
+    }
+
+    batch->round++;
+
+}
+
+
+/**
+ * Copy every garden in a batch back to its simulation, with its random numbers
+ * @param batch The batch
+ * @param sims The simulations it was made from, in the same order
+ */
+void batch_unpack(garden_batch * batch, simulation ** sims) {
+
+    int positions = batch->x * batch->y;
+    cell * rows = malloc((size_t) positions * sizeof(cell));
+
+    for (int l = 0; l < batch->count; l++) {
+        for (int p = 0; p < positions; p++) rows[p] = batch->cells[(size_t) p * BATCH_LANES + l];
+        sim_put_rows(sims[l], 0, batch->x, rows);
+
+        sims[l]->rng = batch->rng[l];
+        sims[l]->lettuce_grow = batch->lettuce_grow[l];
+        sims[l]->slug_reproduce = batch->slug_reproduce[l];
+        sims[l]->frog_reproduce = batch->frog_reproduce[l];
+        sims[l]->round = batch->round;
+    }
+
+    free(rows);
+
+}
+
+
+/**
+ * Count each species in every garden of a batch
+ * @param batch The batch
+ * @param counts Set to the frogs, slugs and lettuce of each lane
+ */
+void batch_species(const garden_batch * batch, int counts[BATCH_LANES][ENSEMBLE_SPECIES]) {
+
+    int positions = batch->x * batch->y;
+
+    for (int l = 0; l < BATCH_LANES; l++)
+        for (int k = 0; k < ENSEMBLE_SPECIES; k++) counts[l][k] = 0;
+
+    for (int p = 0; p < positions; p++) {
+        const cell * here = batch->cells + (size_t) p * BATCH_LANES;
+        for (int l = 0; l < BATCH_LANES; l++)
+            for (int k = 0; k < ENSEMBLE_SPECIES; k++) counts[l][k] += (here[l] & CELL_TYPE_MASK) == (cell) k + 1;
+    }
+
+}
+
+
+/**
+ * Free a batch, the simulations it was made from are left alone
+ * @param batch The batch, may be NULL
+ */
+void batch_free(garden_batch * batch) {
+
+    if (batch == NULL) return;
+
+    free(batch->cells);
+    free(batch->neighbour);
+    free(batch->slot_kind);
+    free(batch->step);
+    free(batch);
+
+}
@@ -0,0 +1,69 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_BATCH_H
+#define GARDEN_PARADISE_BATCH_H
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "ensemble.h"
+#include "global_structs.h"
+#include "utils.h"
+
+
+// Gardens run side by side in a batch, one to each lane of a vector of cells
+#if defined(__AVX512F__)
+#define BATCH_LANES 16
+#else
+#define BATCH_LANES 8
+#endif
+
+
+// Several small gardens of the same size and rules, run in lockstep
+// Cell p of every garden is side by side, so each step of a turn is done for every garden
+// at once, and each garden still has its own random numbers and takes its own turns
+typedef struct {
+
+    int x;
+    int y;
+    bool wrap;
+    // How many lanes have a garden in them
+    int count;
+    int round;
+
+    // Shared by every garden, it is the first garden's
+    CONFIG * config;
+
+    // cells[p * BATCH_LANES + lane], where p is x * y + y
+    cell * cells;
+
+    // The window around each position that turns look at, slots cells of it for every
+    // position, not counting the middle. neighbour[p * slots + slot] is -1 off the garden
+    int slots;
+    int * neighbour;
+    unsigned char * slot_kind;
+    // One step NORTH, EAST, SOUTH and WEST of each position, -1 off the garden
+    int * step;
+
+    random_generator rng[BATCH_LANES];
+    skip_counter lettuce_grow[BATCH_LANES];
+    skip_counter slug_reproduce[BATCH_LANES];
+    skip_counter frog_reproduce[BATCH_LANES];
+
+} garden_batch;
+
+
+// Batch functions
+garden_batch * batch_create(simulation ** sims, int count);
+void batch_round(garden_batch * batch);
+void batch_unpack(garden_batch * batch, simulation ** sims);
+void batch_species(const garden_batch * batch, int counts[BATCH_LANES][ENSEMBLE_SPECIES]);
+void batch_free(garden_batch * batch);
+
+
+#endif //GARDEN_PARADISE_BATCH_H
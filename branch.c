@@ -0,0 +1,308 @@
+//
+// Created on 19/10/2026.
+//
+
+// fork, shared mappings and waiting for processes are not part of standard C
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+#include "branch.h"
+#include "ensemble.h"
+#include "game_control.h"
+#include "simulation.h"
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * Count what is left in a branch and put it in its row of the results
+ * @param sim The simulation
+ * @param result Its row of the results
+ */
+static void branch_count(simulation * sim, branch_result * result) {
+
+    int counts[ENSEMBLE_SPECIES];
+    ensemble_species(sim, counts);
+
+    result->frogs = counts[FROG];
+    result->slugs = counts[SLUG];
+    result->lettuce = counts[LETTUCE];
+    result->round = sim->round;
+    result->done = 1;
+
+}
+
+
+/**
+ * Run one branch in a process of its own, and never come back
+ * The process starts as a copy of the garden, so only the pages it changes are copied
+ * @param sim The simulation, this process's copy of it
+ * @param seed The seed shared by every branch
+ * @param branch Which branch this is
+ * @param rounds How many rounds to run it for
+ * @param result Its row of the results, shared with every other process
+ * @param points The statistics of the worker slot this branch runs in, NULL to not keep any.
+ *               Only one branch at a time has the slot, so nothing else writes to them
+ * @param every How many rounds go into each point
+ */
+static void branch_child(simulation * sim, const uint64_t seed, const int branch, const int rounds,
+                         branch_result * result, ensemble_point * points, const int every) {
+
+    // The engine's threads weren't copied, so it can't be used or freed here
+    // and the series, heatmap and cluster log are this process's to keep
+    sim->engine = NULL;
+    sim->series = NULL;
+    sim->heatmap = NULL;
+    sim->clusters = NULL;
+
+    random_seed(&sim->rng, seed ^ mix64((uint64_t) branch + 1));
+    skip_counter_init(&sim->lettuce_grow);
+    skip_counter_init(&sim->slug_reproduce);
+    skip_counter_init(&sim->frog_reproduce);
+
+    for (int r = 0; r < rounds; r++) {
+        garden_round(sim);
+
+        // The last round of each point stands for all of them
+        if (points != NULL && ((r + 1) % every == 0 || r + 1 == rounds)) {
+            int counts[ENSEMBLE_SPECIES];
+            ensemble_species(sim, counts);
+            ensemble_point_add(&points[r / every], counts);
+            atomic_store_explicit(&result->points, r / every + 1, memory_order_release);
+        }
+    }
+
+    branch_count(sim, result);
+
+    _exit(EXIT_SUCCESS);
+
+}
+
+
+/**
+ * Write the points of the statistics every branch has got past
+ * The points a branch has passed are finished with, so the ones of the other slots can be
+ * merged into the first slot's while branches are still running
+ * @param stats The statistics of every slot
+ * @param workers How many slots
+ * @param points How many points each slot has
+ * @param results A row for each branch
+ * @param branches How many branches
+ * @param written How many points have been written already
+ * @param all Write every point that is left, whether or not the branches got past them
+ * @param every How many rounds go into each point
+ * @param rounds How many rounds each branch runs for
+ * @param start The round the branches started from
+ * @param series Where to write them
+ * @return How many points have been written now
+ */
+static int branch_write(ensemble_point * stats, const int workers, const int points, const branch_result * results,
+                        const int branches, const int written, const bool all, const int every, const int rounds,
+                        const int start, FILE * series) {
+
+    int ready = points;
+    for (int b = 0; b < branches && !all; b++) {
+        int passed = atomic_load_explicit(&results[b].points, memory_order_acquire);
+        if (passed < ready) ready = passed;
+    }
+
+    for (int p = written; p < ready; p++) {
+        for (int w = 1; w < workers; w++)
+            ensemble_point_merge(&stats[p], &stats[(size_t) w * (size_t) points + p]);
+
+        int last = (p + 1) * every < rounds ? (p + 1) * every : rounds;
+        ensemble_write(series, &stats[p], start + last);
+    }
+    if (ready > written) fflush(series);
+
+    return ready > written ? ready : written;
+
+}
+
+
+/**
+ * Run a number of futures of a simulation from where it is now
+ * Each branch is a forked copy of the garden with random numbers of its own, so every
+ * branch starts from the same state without reloading or rerunning it, and the pages of the
+ * garden are shared until a branch changes them. PROCESSES branches run at once, or one for
+ * every CPU if it is 1. Each writes what it ended up as to its row of a table shared with
+ * this process. The simulation itself is left as it was
+ *
+ * With a series, the spread of each species over the branches is kept for every round, or
+ * every few rounds if there are more than ENSEMBLE_POINTS. Each worker slot has statistics
+ * of its own in another shared table, which only the branch running in the slot adds to, so
+ * nothing is locked. Each branch marks how far it has got, and once every branch has got
+ * past a point it is merged and written to the time series while the last ones finish
+ *
+ * Gardens kept in a file are shared with the file rather than copied, so they aren't branched
+ * @param sim The simulation
+ * @param branches How many branches
+ * @param rounds How many rounds to run each one for
+ * @param series Where to write the time series, NULL for none
+ * @return A row for each branch, NULL if they couldn't be run. Free with branch_free
+ */
+branch_result * branch_run(simulation * sim, const int branches, const int rounds, FILE * series) {
+
+    if (branches <= 0 || sim->file != NULL) return NULL;
+
+    size_t size = (size_t) branches * sizeof(branch_result);
+    branch_result * results = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) return NULL;
+
+    int workers = sim->config->PROCESSES;
+    if (workers <= 1) workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1) workers = 1;
+
+    // Statistics for each slot, points of every rounds each
+    int every = ensemble_every(rounds);
+    int points = rounds > 0 ? (rounds + every - 1) / every : 0;
+    size_t stats_size = (size_t) workers * (size_t) points * sizeof(ensemble_point);
+    ensemble_point * stats = NULL;
+    if (series != NULL && points > 0) {
+        stats = mmap(NULL, stats_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (stats == MAP_FAILED) stats = NULL;
+    }
+
+    // Which process is in each slot
+    pid_t * slots = calloc((size_t) workers, sizeof(pid_t));
+
+    uint64_t seed = random_bits(&sim->rng);
+    int running = 0;
+
+    // Nothing left unwritten for the children to write out again
+    fflush(stdout);
+    if (series != NULL) fflush(series);
+    for (int b = 0; b < branches; b++) {
+
+        // Wait for a free slot
+        pid_t done;
+        while (running == workers && (done = waitpid(-1, NULL, 0)) > 0) {
+            for (int w = 0; w < workers; w++)
+                if (slots[w] == done) {
+                    slots[w] = 0;
+                    running--;
+                }
+        }
+
+        int slot = 0;
+        while (slot < workers - 1 && slots[slot] != 0) slot++;
+
+        pid_t child = fork();
+        if (child == 0)
+            branch_child(sim, seed, b, rounds, &results[b],
+                         stats != NULL ? stats + (size_t) slot * (size_t) points : NULL, every);
+        if (child > 0) {
+            slots[slot] = child;
+            running++;
+        }
+    }
+
+    // With statistics, look in now and then to write out the points every branch has passed
+    int written = 0;
+    if (stats != NULL) ensemble_header(series);
+    while (running > 0) {
+        pid_t done = waitpid(-1, NULL, stats != NULL ? WNOHANG : 0);
+        if (done < 0) break;
+        if (done > 0) running--;
+
+        if (stats == NULL) continue;
+        written = branch_write(stats, workers, points, results, branches, written, false, every, rounds,
+                               sim->round, series);
+        if (done == 0) {
+            struct timespec wait = {0, 1000000};
+            nanosleep(&wait, NULL);
+        }
+    }
+
+    // Branches that couldn't be run or didn't finish leave the rest to be written as they are
+    if (stats != NULL) {
+        branch_write(stats, workers, points, results, branches, written, true, every, rounds, sim->round, series);
+        munmap(stats, stats_size);
+    }
+
+    free(slots);
+
+    return results;
+
+}
+
+
+/**
+ * Free the results of branch_run
+ * @param results The results, may be NULL
+ * @param branches How many branches there were
+ */
+void branch_free(branch_result * results, const int branches) {
+
+    if (results == NULL) return;
+
+    munmap(results, (size_t) branches * sizeof(branch_result));
+
+}
+
+#else
+
+// No fork, so there is nothing to branch with
+branch_result * branch_run(simulation * sim, const int branches, const int rounds, FILE * series) {
+    (void) sim;
+    (void) branches;
+    (void) rounds;
+    (void) series;
+    return NULL;
+}
+
+void branch_free(branch_result * results, const int branches) {
+    (void) results;
+    (void) branches;
+}
+
+#endif
+
+
+/**
+ * Print how the branches of a simulation turned out
+ * @param results The results from branch_run
+ * @param branches How many branches there were
+ */
+void branch_print(const branch_result * results, const int branches) {
+
+    const char * names[3] = {"Frogs", "Slugs", "Lettuce"};
+    int finished = 0;
+    int round = 0;
+    double mean[3] = {0, 0, 0};
+    int low[3] = {0, 0, 0};
+    int high[3] = {0, 0, 0};
+
+    for (int b = 0; b < branches; b++) {
+        if (!results[b].done) continue;
+
+        int counts[3] = {results[b].frogs, results[b].slugs, results[b].lettuce};
+        for (int k = 0; k < 3; k++) {
+            mean[k] += counts[k];
+            if (!finished || counts[k] < low[k]) low[k] = counts[k];
+            if (!finished || counts[k] > high[k]) high[k] = counts[k];
+        }
+        round = results[b].round;
+        finished++;
+    }
+
+    printf("%d of %d branches finished", finished, branches);
+    if (!finished) {
+        printf("\n");
+        return;
+    }
+    printf(" at round %d\n", round);
+
+    for (int k = 0; k < 3; k++)
+        printf("%-8s mean %.2f, min %d, max %d\n", names[k], mean[k] / finished, low[k], high[k]);
+
+}
@@ -0,0 +1,40 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_BRANCH_H
+#define GARDEN_PARADISE_BRANCH_H
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// What one branch ended up as, written by the process that ran it
+typedef struct {
+
+    // Set once the branch has finished, anything else is left as zero
+    int done;
+    int round;
+    // How many points of the statistics the branch has added to, as it goes
+    _Atomic int points;
+
+    int frogs;
+    int slugs;
+    int lettuce;
+
+} branch_result;
+
+
+// Branch functions
+branch_result * branch_run(simulation * sim, int branches, int rounds, FILE * series);
+void branch_print(const branch_result * results, int branches);
+void branch_free(branch_result * results, int branches);
+
+
+#endif //GARDEN_PARADISE_BRANCH_H
@@ -0,0 +1,215 @@
+//
+// Created on 19/10/2026.
+//
+
+#include "chunk_map.h"
+
+
+
+/**
+ * Find the slot a chunk position hashes to
+ * @param map The map
+ * @param cx Chunk x position
+ * @param cy Chunk y position
+ * @return The index of the first slot to probe
+ */
+static int chunk_map_home(chunk_map * map, const int cx, const int cy) {
+
+    uint64_t key = ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+    return (int) (mix64(key) & (uint64_t) (map->capacity - 1));
+
+}
+
+
+/**
+ * Find the slot holding a chunk, or the empty slot where it would go
+ * @param map The map
+ * @param cx Chunk x position
+ * @param cy Chunk y position
+ * @return The slot index
+ */
+static int chunk_map_find(chunk_map * map, const int cx, const int cy) {
+
+    int slot = chunk_map_home(map, cx, cy);
+
+    // Linear probing, the map is never more than half full so this always ends
+    while (map->slots[slot] != NULL) {
+        if (map->slots[slot]->cx == cx && map->slots[slot]->cy == cy) return slot;
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    return slot;
+
+}
+
+
+/**
+ * Double the number of slots in a map and re-insert every chunk
+ * @param map The map
+ */
+static void chunk_map_grow(chunk_map * map) {
+
+    chunk ** old = map->slots;
+    int old_capacity = map->capacity;
+
+    map->capacity *= 2;
+    map->slots = calloc(map->capacity, sizeof(chunk *));
+
+    for (int n = 0; n < old_capacity; n++)
+        if (old[n] != NULL)
+            map->slots[chunk_map_find(map, old[n]->cx, old[n]->cy)] = old[n];
+
+    free(old);
+
+}
+
+
+/**
+ * Create an empty chunk map
+ * @return The pointer
+ */
+chunk_map * chunk_map_init(void) {
+
+    chunk_map * out = malloc(sizeof(chunk_map));
+    out->capacity = 16;
+    out->count = 0;
+    out->slots = calloc(out->capacity, sizeof(chunk *));
+
+    return out;
+
+}
+
+
+/**
+ * Get the chunk at a chunk position
+ * @param map The map
+ * @param cx Chunk x position
+ * @param cy Chunk y position
+ * @return The chunk, NULL if it isn't allocated
+ */
+chunk * chunk_map_get(chunk_map * map, const int cx, const int cy) {
+
+    return map->slots[chunk_map_find(map, cx, cy)];
+
+}
+
+
+/**
+ * Get the chunk at a chunk position, allocating an empty one if needed
+ * @param map The map
+ * @param cx Chunk x position
+ * @param cy Chunk y position
+ * @return The chunk
+ */
+chunk * chunk_map_make(chunk_map * map, const int cx, const int cy) {
+
+    int slot = chunk_map_find(map, cx, cy);
+    if (map->slots[slot] != NULL) return map->slots[slot];
+
+    // Keep the load factor at or below a half
+    if (2 * (map->count + 1) > map->capacity) {
+        chunk_map_grow(map);
+        slot = chunk_map_find(map, cx, cy);
+    }
+
+    // Zeroed cells are EMPTY
+    chunk * out = calloc(1, sizeof(chunk));
+    out->cx = cx;
+    out->cy = cy;
+
+    map->slots[slot] = out;
+    map->count++;
+
+    return out;
+
+}
+
+
+/**
+ * Free the chunk at a chunk position, if there is one
+ * @param map The map
+ * @param cx Chunk x position
+ * @param cy Chunk y position
+ */
+void chunk_map_remove(chunk_map * map, const int cx, const int cy) {
+
+    int slot = chunk_map_find(map, cx, cy);
+    if (map->slots[slot] == NULL) return;
+
+    free(map->slots[slot]);
+    map->slots[slot] = NULL;
+    map->count--;
+
+    // Shift back any chunks that probed past the freed slot, so lookups never stop early
+    int next = (slot + 1) & (map->capacity - 1);
+    while (map->slots[next] != NULL) {
+
+        int home = chunk_map_home(map, map->slots[next]->cx, map->slots[next]->cy);
+
+        // Move it if its home isn't cyclically within (slot, next]
+        if (((next - home) & (map->capacity - 1)) >= ((next - slot) & (map->capacity - 1))) {
+            map->slots[slot] = map->slots[next];
+            map->slots[next] = NULL;
+            slot = next;
+        }
+
+        next = (next + 1) & (map->capacity - 1);
+    }
+
+}
+
+
+/**
+ * Compare two chunks by position, x first
+ * @param a Pointer to the first chunk pointer
+ * @param b Pointer to the second chunk pointer
+ * @return qsort ordering
+ */
+static int chunk_compare(const void * a, const void * b) {
+
+    const chunk * c1 = * (chunk * const *) a;
+    const chunk * c2 = * (chunk * const *) b;
+
+    if (c1->cx != c2->cx) return c1->cx < c2->cx ? -1 : 1;
+    if (c1->cy != c2->cy) return c1->cy < c2->cy ? -1 : 1;
+    return 0;
+
+}
+
+
+/**
+ * List every chunk in a map, sorted by x then y
+ * The list must be freed by the caller, the chunks must not
+ * @param map The map
+ * @return Array of map->count chunk pointers
+ */
+chunk ** chunk_map_sorted(chunk_map * map) {
+
+    chunk ** out = malloc((map->count + 1) * sizeof(chunk *));
+    int size = 0;
+
+    for (int n = 0; n < map->capacity; n++)
+        if (map->slots[n] != NULL) out[size++] = map->slots[n];
+
+    qsort(out, size, sizeof(chunk *), chunk_compare);
+
+    return out;
+
+}
+
+
+/**
+ * Free a map and all of its chunks
+ * @param map The map
+ */
+void chunk_map_free(chunk_map * map) {
+
+    if (map == NULL) return;
+
+    for (int n = 0; n < map->capacity; n++)
+        free(map->slots[n]);
+
+    free(map->slots);
+    free(map);
+
+}
@@ -0,0 +1,79 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_CHUNK_MAP_H
+#define GARDEN_PARADISE_CHUNK_MAP_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+#include "utils.h"
+
+#include "global_structs.h"
+
+
+// Chunks are CHUNK_SIZE x CHUNK_SIZE squares of the garden
+#define CHUNK_BITS 6
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+
+
+// A square of a sparse garden, only allocated while something lives in it
+typedef struct {
+
+    int cx;
+    int cy;
+
+    // Number of non-EMPTY cells
+    int population;
+
+    // Bit y of occupied[x] is set when cells[x][y] isn't EMPTY
+    uint64_t occupied[CHUNK_SIZE];
+
+    cell cells[CHUNK_SIZE][CHUNK_SIZE];
+
+} chunk;
+
+
+/**
+ * Position of the lowest set bit of a row of occupancy bits
+ * @param bits The bits, not 0
+ * @return The position
+ */
+static inline int chunk_first_bit(const uint64_t bits) {
+
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int n = 0;
+    while (!(bits >> n & 1)) n++;
+    return n;
+#endif
+
+}
+
+
+// Open addressing hash map from chunk position to chunk
+struct CHUNK_MAP {
+
+    chunk ** slots;
+    int capacity;
+    int count;
+
+};
+
+
+// Chunk_map functions
+chunk_map * chunk_map_init(void);
+chunk * chunk_map_get(chunk_map * map, int cx, int cy);
+chunk * chunk_map_make(chunk_map * map, int cx, int cy);
+void chunk_map_remove(chunk_map * map, int cx, int cy);
+chunk ** chunk_map_sorted(chunk_map * map);
+void chunk_map_free(chunk_map * map);
+
+
+#endif //GARDEN_PARADISE_CHUNK_MAP_H
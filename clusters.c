@@ -0,0 +1,512 @@
+//
+// Created on 19/10/2026.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clusters.h"
+#include "simulation.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+
+struct CLUSTER_LOG {
+
+    FILE * file;
+    int every;
+    // Cells touching at a corner are in the same cluster, not just those sharing a side
+    bool diagonal;
+
+};
+
+
+// Everything the bands of a search share
+// Every cell is a node of a union-find forest, and each tree is a cluster
+typedef struct {
+
+    simulation * sim;
+    bool diagonal;
+
+    // How many nodes. Every cell of a dense garden, only the occupied ones of a sparse one
+    size_t count;
+    // CELL_TYPE_MASK bits of every node, 0 for empty cells and walls
+    unsigned char * types;
+    // Parent of every node in its tree, always a node before it, so roots come first
+    size_t * parent;
+    // Sparse gardens only, row * columns + column of every node, in row-major order
+    uint64_t * keys;
+
+} cluster_search;
+
+// One band of rows, searched on its own
+typedef struct {
+
+    cluster_search * search;
+    int from;
+    int to;
+
+} cluster_band;
+
+
+/**
+ * Find the root of a node's tree, halving the path to it on the way
+ * @param parent The forest
+ * @param i The node
+ * @return The root
+ */
+static size_t cluster_root(size_t * parent, size_t i) {
+
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+
+}
+
+
+/**
+ * Join the trees of two nodes if they hold the same species
+ * The later root goes under the earlier one, so every parent comes before its children
+ * @param search The search
+ * @param a A node
+ * @param b Another node
+ */
+static void cluster_join(cluster_search * search, const size_t a, const size_t b) {
+
+    if (!search->types[a] || search->types[a] != search->types[b]) return;
+
+    size_t ra = cluster_root(search->parent, a);
+    size_t rb = cluster_root(search->parent, b);
+
+    if (ra < rb) search->parent[rb] = ra;
+    else if (rb < ra) search->parent[ra] = rb;
+
+}
+
+
+/**
+ * Find the node of a cell in a sparse garden
+ * @param search The search
+ * @param key row * columns + column of the cell
+ * @param at Set to the node
+ * @return false if nothing is there
+ */
+static bool cluster_node(const cluster_search * search, const uint64_t key, size_t * at) {
+
+    size_t low = 0;
+    size_t high = search->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (search->keys[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+
+    * at = low;
+    return low < search->count && search->keys[low] == key;
+
+}
+
+
+/**
+ * Join a cell to another at an offset from it, if that is on the garden
+ * @param search The search
+ * @param node The node of the cell
+ * @param x The row of the cell
+ * @param y The column of the cell
+ * @param dx Rows to the other cell
+ * @param dy Columns to the other cell
+ */
+static void cluster_join_at(cluster_search * search, const size_t node, const int x, const int y, const int dx,
+                            const int dy) {
+
+    int to[2] = {x + dx, y + dy};
+    if (!sim_wrap(search->sim, to)) return;
+
+    size_t width = (size_t) search->sim->y;
+    size_t other = (size_t) to[0] * width + (size_t) to[1];
+    if (search->keys != NULL && !cluster_node(search, other, &other)) return;
+
+    cluster_join(search, node, other);
+
+}
+
+
+/**
+ * Search a band of rows, joining every cell to the cells before it in the band
+ * Only cells in the band are touched, so bands can be searched at the same time
+ * @param band The band
+ */
+static void cluster_band_search(cluster_band * band) {
+
+    cluster_search * search = band->search;
+    simulation * sim = search->sim;
+    size_t width = (size_t) sim->y;
+
+    cell * row = malloc(width * sizeof(cell));
+    for (int x = band->from; x < band->to; x++) {
+        sim_get_rows(sim, x, x + 1, row);
+        for (size_t y = 0; y < width; y++)
+            search->types[(size_t) x * width + y] = (unsigned char) (row[y] & CELL_TYPE_MASK);
+    }
+    free(row);
+
+    unsigned char * types = search->types;
+    size_t * parent = search->parent;
+
+    // Each cell takes the parent of a neighbour it matches, and neighbours only need joining
+    // when nothing already joins them, so most cells never look for a root
+    for (int x = band->from; x < band->to; x++) {
+        for (size_t y = 0; y < width; y++) {
+            size_t i = (size_t) x * width + y;
+            unsigned char t = types[i];
+            parent[i] = i;
+            if (!t) continue;
+
+            bool up = x > band->from;
+            bool w = y > 0 && types[i - 1] == t;
+            bool n = up && types[i - width] == t;
+            bool nw = up && y > 0 && types[i - width - 1] == t;
+            bool ne = up && y + 1 < width && types[i - width + 1] == t;
+
+            if (!search->diagonal) {
+                // With the cell above and to the left matching too, they are already joined
+                if (w && n && !nw) cluster_join(search, i - 1, i - width);
+                if (w) parent[i] = parent[i - 1];
+                else if (n) parent[i] = parent[i - width];
+                continue;
+            }
+
+            // The cell above touches every other neighbour, so is already joined to them
+            if (n) {
+                parent[i] = parent[i - width];
+            } else if (ne) {
+                if (nw) cluster_join(search, i - width + 1, i - width - 1);
+                else if (w) cluster_join(search, i - width + 1, i - 1);
+                parent[i] = parent[i - width + 1];
+            } else if (nw) {
+                parent[i] = parent[i - width - 1];
+            } else if (w) {
+                parent[i] = parent[i - 1];
+            }
+        }
+    }
+
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * Start a band search on a thread of its own
+ * @param arg The band
+ * @return NULL
+ */
+static void * cluster_band_thread(void * arg) {
+
+    cluster_band_search(arg);
+    return NULL;
+
+}
+
+#endif
+
+
+/**
+ * Join up every cell of a dense garden
+ * The garden is split into a band of rows for each of THREADS threads, and each band is
+ * joined up on its own. The seams between bands, and the edges of gardens that wrap, are
+ * then joined on this thread
+ * @param search The search, with a node for every cell
+ */
+static void clusters_dense(cluster_search * search) {
+
+    simulation * sim = search->sim;
+    int height = sim->x;
+    int width = sim->y;
+
+    int bands = sim->config->THREADS > 1 ? sim->config->THREADS : 1;
+    if (bands > height) bands = height;
+
+    cluster_band * band = malloc((size_t) bands * sizeof(cluster_band));
+    for (int b = 0; b < bands; b++) {
+        band[b].search = search;
+        band[b].from = (int) ((long long) height * b / bands);
+        band[b].to = (int) ((long long) height * (b + 1) / bands);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    pthread_t * threads = malloc((size_t) bands * sizeof(pthread_t));
+    bool * started = calloc((size_t) bands, sizeof(bool));
+
+    for (int b = 1; b < bands; b++)
+        started[b] = !pthread_create(&threads[b], NULL, cluster_band_thread, &band[b]);
+    cluster_band_search(&band[0]);
+
+    // Any band that didn't get a thread is searched here
+    for (int b = 1; b < bands; b++) {
+        if (started[b]) pthread_join(threads[b], NULL);
+        else cluster_band_search(&band[b]);
+    }
+
+    free(threads);
+    free(started);
+#else
+    for (int b = 0; b < bands; b++) cluster_band_search(&band[b]);
+#endif
+
+    // The first row of each band to the row above it, the last row too if the garden wraps
+    for (int b = sim->wrap ? 0 : 1; b < bands; b++)
+        for (int y = 0; y < width; y++) {
+            size_t node = (size_t) band[b].from * (size_t) width + (size_t) y;
+            cluster_join_at(search, node, band[b].from, y, -1, 0);
+            if (!search->diagonal) continue;
+            cluster_join_at(search, node, band[b].from, y, -1, -1);
+            cluster_join_at(search, node, band[b].from, y, -1, 1);
+        }
+
+    // The first column to the last
+    if (sim->wrap)
+        for (int x = 0; x < height; x++) {
+            size_t node = (size_t) x * (size_t) width;
+            cluster_join_at(search, node, x, 0, 0, -1);
+            if (!search->diagonal) continue;
+            cluster_join_at(search, node, x, 0, -1, -1);
+            cluster_join_at(search, node, x, 0, 1, -1);
+        }
+
+    free(band);
+
+}
+
+
+/**
+ * Make the nodes of a search, every cell of a dense garden or the occupied cells of a sparse one
+ * @param search The search
+ * @return false if there wasn't the memory for them
+ */
+static bool cluster_nodes(cluster_search * search) {
+
+    simulation * sim = search->sim;
+
+    if (sim->garden != NULL) {
+        search->count = (size_t) sim->x * (size_t) sim->y;
+        search->types = malloc(search->count);
+        search->parent = malloc(search->count * sizeof(size_t));
+        return search->types != NULL && search->parent != NULL;
+    }
+
+    // Sparse gardens are walked in row-major order, so the keys come out sorted
+    size_t capacity = 1024;
+    bool ok = true;
+    search->count = 0;
+    search->keys = malloc(capacity * sizeof(uint64_t));
+    search->types = malloc(capacity);
+    if (search->keys == NULL || search->types == NULL) return false;
+
+    garden_walk walk;
+    sim_walk_start(sim, &walk);
+    while (ok && sim_walk_next(sim, &walk)) {
+        if (search->count == capacity) {
+            capacity *= 2;
+            uint64_t * keys = realloc(search->keys, capacity * sizeof(uint64_t));
+            if (keys != NULL) search->keys = keys;
+            unsigned char * types = realloc(search->types, capacity);
+            if (types != NULL) search->types = types;
+            ok = keys != NULL && types != NULL;
+            if (!ok) break;
+        }
+        search->keys[search->count] = (uint64_t) walk.pos[0] * (uint64_t) sim->y + (uint64_t) walk.pos[1];
+        search->types[search->count++] = (unsigned char) (sim_get(sim, walk.pos).inhabitant_type + 1);
+    }
+    sim_walk_end(&walk);
+
+    search->parent = malloc((search->count ? search->count : 1) * sizeof(size_t));
+    return ok && search->parent != NULL;
+
+}
+
+
+/**
+ * Join up the occupied cells of a sparse garden
+ * Only occupied cells are nodes, so this costs about as much as the garden has inhabitants
+ * however big it is. Each cell is joined to the neighbours above it and to its left, which
+ * between them cover every pair of neighbours, wrapped or not
+ * @param search The search, with a node for every occupied cell
+ */
+static void clusters_sparse(cluster_search * search) {
+
+    size_t width = (size_t) search->sim->y;
+
+    for (size_t i = 0; i < search->count; i++) search->parent[i] = i;
+
+    for (size_t i = 0; i < search->count; i++) {
+        int x = (int) (search->keys[i] / width);
+        int y = (int) (search->keys[i] % width);
+        cluster_join_at(search, i, x, y, 0, -1);
+        cluster_join_at(search, i, x, y, -1, 0);
+        if (!search->diagonal) continue;
+        cluster_join_at(search, i, x, y, -1, -1);
+        cluster_join_at(search, i, x, y, -1, 1);
+    }
+
+}
+
+
+/**
+ * Find the clusters of each species, the groups of cells of it that touch each other
+ * Cells are joined up with union-find, every cell of a dense garden in bands on THREADS
+ * threads, and only the occupied cells of a sparse garden. A last pass counts each tree
+ * @param sim The simulation
+ * @param diagonal If cells touching at a corner count, not just those sharing a side
+ * @param out The clusters of frogs, slugs and lettuce
+ * @return false if there wasn't the memory to label the garden
+ */
+bool clusters_find(simulation * sim, const bool diagonal, cluster_stats out[CLUSTER_SPECIES]) {
+
+    cluster_search search;
+    search.sim = sim;
+    search.diagonal = diagonal;
+    search.types = NULL;
+    search.parent = NULL;
+    search.keys = NULL;
+
+    bool ok = cluster_nodes(&search);
+    if (ok && sim->garden != NULL) clusters_dense(&search);
+    else if (ok) clusters_sparse(&search);
+
+    // Roots come before everything under them, so in one pass in order each node can take
+    // its cluster from its parent. Each root is given the next cluster in place of its parent
+    size_t capacity = 1024;
+    size_t count = 0;
+    size_t * sizes = ok ? malloc(capacity * sizeof(size_t)) : NULL;
+    unsigned char * species = ok ? malloc(capacity) : NULL;
+    ok = sizes != NULL && species != NULL;
+
+    for (size_t i = 0; ok && i < search.count; i++) {
+        if (!search.types[i]) continue;
+
+        size_t up = search.parent[i];
+        if (up != i) {
+            search.parent[i] = search.parent[up];
+            sizes[search.parent[i]]++;
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity *= 2;
+            size_t * more_sizes = realloc(sizes, capacity * sizeof(size_t));
+            unsigned char * more_species = realloc(species, capacity);
+            if (more_sizes != NULL) sizes = more_sizes;
+            if (more_species != NULL) species = more_species;
+            if (more_sizes == NULL || more_species == NULL) {
+                ok = false;
+                break;
+            }
+        }
+        sizes[count] = 1;
+        species[count] = search.types[i];
+        search.parent[i] = count++;
+    }
+
+    memset(out, 0, CLUSTER_SPECIES * sizeof(cluster_stats));
+    for (size_t n = 0; ok && n < count; n++) {
+        cluster_stats * stats = &out[species[n] - 1];
+
+        int bin = 0;
+        while (bin + 1 < CLUSTER_BINS && sizes[n] >> (bin + 1)) bin++;
+
+        stats->clusters++;
+        stats->cells += sizes[n];
+        stats->histogram[bin]++;
+        if (sizes[n] > stats->largest) stats->largest = sizes[n];
+    }
+
+    free(sizes);
+    free(species);
+    free(search.types);
+    free(search.parent);
+    free(search.keys);
+
+    return ok;
+
+}
+
+
+/**
+ * Start writing the clusters of a simulation to a CSV file every few rounds
+ * Each line is a round, a species, how many clusters and cells it has, the largest
+ * cluster and the histogram, space separated and ending at the last bin with any in it
+ * @param filename The file, overwritten if it is already there
+ * @param every Write every this many rounds
+ * @param diagonal If cells touching at a corner are in the same cluster
+ * @return The log, NULL if the file couldn't be opened. Set it as sim->clusters
+ */
+cluster_log * cluster_log_open(const char * filename, const int every, const bool diagonal) {
+
+    FILE * file = fopen(filename, "w");
+    if (file == NULL) return NULL;
+
+    cluster_log * out = malloc(sizeof(cluster_log));
+    out->file = file;
+    out->every = every > 1 ? every : 1;
+    out->diagonal = diagonal;
+
+    fprintf(file, "round,species,clusters,cells,largest,histogram\n");
+
+    return out;
+
+}
+
+
+/**
+ * Write the clusters of a simulation to its log, if this round is one to write
+ * @param sim The simulation, after its round has settled
+ */
+void clusters_sample(simulation * sim) {
+
+    cluster_log * log = sim->clusters;
+    if (sim->round % log->every) return;
+
+    const char * names[CLUSTER_SPECIES] = {"frog", "slug", "lettuce"};
+    cluster_stats stats[CLUSTER_SPECIES];
+
+    // A garden too big to label now won't be any smaller later, so the log stops here
+    if (!clusters_find(sim, log->diagonal, stats)) {
+        printf("Couldn't find the clusters of round %d, there isn't the memory for a garden this big\n",
+               sim->round);
+        cluster_log_close(log);
+        sim->clusters = NULL;
+        return;
+    }
+
+    for (int k = 0; k < CLUSTER_SPECIES; k++) {
+        fprintf(log->file, "%d,%s,%zu,%zu,%zu,", sim->round, names[k], stats[k].clusters, stats[k].cells,
+                stats[k].largest);
+
+        int bins = CLUSTER_BINS;
+        while (bins > 0 && !stats[k].histogram[bins - 1]) bins--;
+        for (int b = 0; b < bins; b++) fprintf(log->file, b ? " %zu" : "%zu", stats[k].histogram[b]);
+        fprintf(log->file, "\n");
+    }
+
+}
+
+
+/**
+ * Close a cluster log
+ * @param log The log, may be NULL
+ */
+void cluster_log_close(cluster_log * log) {
+
+    if (log == NULL) return;
+
+    fclose(log->file);
+    free(log);
+
+}
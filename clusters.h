@@ -0,0 +1,43 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_CLUSTERS_H
+#define GARDEN_PARADISE_CLUSTERS_H
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Bin k of the histogram has the clusters of 2^k to 2^(k + 1) - 1 cells
+#define CLUSTER_BINS 32
+
+// Frogs, slugs and lettuce
+#define CLUSTER_SPECIES 3
+
+
+// The clusters of one species, groups of them touching each other
+typedef struct {
+
+    size_t clusters;
+    // Cells of the species, in any cluster
+    size_t cells;
+    size_t largest;
+    size_t histogram[CLUSTER_BINS];
+
+} cluster_stats;
+
+
+// Cluster functions
+bool clusters_find(simulation * sim, bool diagonal, cluster_stats out[CLUSTER_SPECIES]);
+cluster_log * cluster_log_open(const char * filename, int every, bool diagonal);
+void clusters_sample(simulation * sim);
+void cluster_log_close(cluster_log * log);
+
+
+#endif //GARDEN_PARADISE_CLUSTERS_H
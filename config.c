@@ -62,6 +62,17 @@ CONFIG * create_config(const char * name,
     out->FROG_REPRODUCE_PROB = frog_reproduce_prob;
     out->FROG_VISION_DISTANCE = frog_vision_distance;
 
+    // Optional settings default to the original 12x12 garden
+    out->GARDEN_ROWS = 12;
+    out->GARDEN_COLUMNS = 12;
+    out->WRAP_AROUND = false;
+    out->SPARSE_GARDEN = false;
+    out->TILED_GARDEN = false;
+    out->THREADS = 1;
+    out->ASYNC_ROUNDS = false;
+    out->PROCESSES = 1;
+    out->GARDEN_FILE[0] = '\000';
+
     return out;
 
 }
@@ -133,16 +144,59 @@ simulation * read_file(const char * filename) {
     if (!read_config_line(configfile, "FROG_VISION_DISTANCE", temp)) return NULL;
     cfg->FROG_VISION_DISTANCE = (int) strtol(temp, NULL, 10);
 
+    // Anything else before the inhabitants
+    bool valid = true;
+    while (read_optional_config_line(configfile, cfg, &valid));
+    if (!valid) {
+        free_config(cfg);
+        fclose(configfile);
+        return NULL;
+    }
+
+    // Cells stop counting age and hunger at CELL_AGE_MAX and CELL_HUNGER_MAX, so nothing
+    // past them would ever be reached
+    if (cfg->SLUG_LIFESPAN >= CELL_AGE_MAX || cfg->FROG_LIFESPAN >= CELL_AGE_MAX ||
+        cfg->FROG_HUNGRY > CELL_HUNGER_MAX) {
+        printf("Lifespans must be under %d and FROG_HUNGRY at most %d\n", CELL_AGE_MAX, CELL_HUNGER_MAX);
+        free_config(cfg);
+        fclose(configfile);
+        return NULL;
+    }
+
+    // Nothing fits in a garden without rows or columns
+    if (cfg->GARDEN_ROWS < 1 || cfg->GARDEN_COLUMNS < 1) {
+        printf("GARDEN_ROWS and GARDEN_COLUMNS must be at least 1\n");
+        free_config(cfg);
+        fclose(configfile);
+        return NULL;
+    }
 
     strncpy(cfg->name, filename, 255);
     cfg->name[255] = '\000';
 
-    simulation * out = create_simulation(12, 12);
-    free_config(out->config);
-    out->config = cfg;
+    simulation * out;
+    if (strcmp(cfg->GARDEN_FILE, ""))
+        out = create_mapped_simulation(cfg->GARDEN_ROWS, cfg->GARDEN_COLUMNS, cfg->GARDEN_FILE);
+    else if (cfg->SPARSE_GARDEN)
+        out = create_sparse_simulation(cfg->GARDEN_ROWS, cfg->GARDEN_COLUMNS);
+    else if (cfg->TILED_GARDEN)
+        out = create_tiled_simulation(cfg->GARDEN_ROWS, cfg->GARDEN_COLUMNS);
+    else
+        out = create_simulation(cfg->GARDEN_ROWS, cfg->GARDEN_COLUMNS);
+
+    if (out == NULL) {
+        free_config(cfg);
+        fclose(configfile);
+        return NULL;
+    }
+
+    sim_set_config(out, cfg);
+
+    // A garden carried on from its file already has its inhabitants
+    bool resumed = out->file != NULL && out->file->resumed;
 
     // Find all inhabitants in file
-    for(int i = 0; i < 10; i++) {
+    for(int i = 0; i < 10 && !resumed; i++) {
         if (!read_inhabitant_line(configfile, out)) break;
 #ifdef DEBUG
         printf("found an inhabitant!\n");
@@ -172,6 +226,66 @@ bool read_config_line(FILE * file, const char * expected, char * store) {
 }
 
 
+/**
+ * Read a line that doesn't have to be in a config file
+ * These go after the required lines and before any inhabitants, in any order.
+ * Supported:
+ *  GARDEN_ROWS n, GARDEN_COLUMNS n - Size of the garden, 12x12 if not given
+ *  WRAP_AROUND 0/1 - Opposite edges of the garden are joined (a torus),
+ *                    fastest when both sizes are powers of two
+ *  SPARSE_GARDEN 0/1 - Only store the parts of the garden that have something in them,
+ *                      for huge gardens with few inhabitants
+ *  TILED_GARDEN 0/1 - Store the garden in small square tiles instead of row by row, so
+ *                     everything a frog can see is close together in memory
+ *  THREADS n - Run each round on n threads, a tile of the garden at a time. The result
+ *              only depends on the seed, but isn't the same as on one thread
+ *  ASYNC_ROUNDS 0/1 - With THREADS, let every thread take inhabitants as it pleases instead
+ *                     of in tile order. Any vision or wrap works, but results vary run to run
+ *  PROCESSES n - Jump on n processes, each with a strip of rows, see domain_run. Branch
+ *                mode runs n branches at once, or one per CPU if n is 1, see branch_run
+ *  GARDEN_FILE name - Keep the garden in this file instead of memory, for gardens larger
+ *                     than memory. If it already holds a garden that garden is carried on
+ * @param file The file
+ * @param cfg The config to store the value in
+ * @param valid Set to false if the line wasn't one of these, or had no value
+ * @return True if a line was read, false once the inhabitants (or end of file) are reached
+ *         or the line wasn't valid
+ */
+bool read_optional_config_line(FILE * file, CONFIG * cfg, bool * valid) {
+
+    char key[256];
+    char value[256];
+
+    // Inhabitant lines start with '(' so won't match
+    if (fscanf(file, " %255[_A-Za-z]", key) != 1) return false;
+    if (fscanf(file, " %255s", value) != 1) {
+        printf("%s has no value\n", key);
+        * valid = false;
+        return false;
+    }
+
+    if (!strcmp(key, "GARDEN_ROWS")) cfg->GARDEN_ROWS = (int) strtol(value, NULL, 10);
+    else if (!strcmp(key, "GARDEN_COLUMNS")) cfg->GARDEN_COLUMNS = (int) strtol(value, NULL, 10);
+    else if (!strcmp(key, "WRAP_AROUND")) cfg->WRAP_AROUND = strtol(value, NULL, 10) != 0;
+    else if (!strcmp(key, "SPARSE_GARDEN")) cfg->SPARSE_GARDEN = strtol(value, NULL, 10) != 0;
+    else if (!strcmp(key, "TILED_GARDEN")) cfg->TILED_GARDEN = strtol(value, NULL, 10) != 0;
+    else if (!strcmp(key, "THREADS")) cfg->THREADS = (int) strtol(value, NULL, 10);
+    else if (!strcmp(key, "ASYNC_ROUNDS")) cfg->ASYNC_ROUNDS = strtol(value, NULL, 10) != 0;
+    else if (!strcmp(key, "PROCESSES")) cfg->PROCESSES = (int) strtol(value, NULL, 10);
+    else if (!strcmp(key, "GARDEN_FILE")) {
+        strncpy(cfg->GARDEN_FILE, value, 255);
+        cfg->GARDEN_FILE[255] = '\000';
+    } else {
+        // A typo would otherwise quietly run a different garden
+        printf("Unknown config line %s\n", key);
+        * valid = false;
+        return false;
+    }
+
+    return true;
+}
+
+
 /**
  * Read an inhabitant line from a config file
  * @param file The file
@@ -186,7 +300,7 @@ bool read_inhabitant_line(FILE * file, simulation * sim) {
     int init_age;
     int hunger;
     DIRECTION next_move;
-    inhabitant * i;
+    inhabitant i;
 
     // Coordinate reading
     // Check for End Of File
@@ -219,10 +333,8 @@ bool read_inhabitant_line(FILE * file, simulation * sim) {
 
     // Create inhabitant
     i = create_inhabitant(type, init_age, next_move);
-    i->hunger = hunger;
+    i.hunger = hunger;
 
-    // Prevent memory leak
-    free_inhabitant(sim_get(sim, coord));
     sim_set(sim, coord, i);
 
     return true;
@@ -36,6 +36,7 @@ void free_config(CONFIG * config);
 
 simulation * read_file(const char * filename);
 bool read_config_line(FILE * file, const char * expected, char * store);
+bool read_optional_config_line(FILE * file, CONFIG * cfg, bool * valid);
 bool read_inhabitant_line(FILE * file, simulation * sim);
 
 #endif //GARDEN_PARADISE_CONFIG_H
@@ -0,0 +1,359 @@
+//
+// Created on 19/10/2026.
+//
+
+// fork, sockets and waiting for processes are not part of standard C
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "domain.h"
+#include "inhabitant.h"
+#include "simulation.h"
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// A process that has gone away shouldn't take the others with it
+#ifdef MSG_NOSIGNAL
+#define DOMAIN_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define DOMAIN_SEND_FLAGS 0
+#endif
+
+
+/**
+ * Send everything down a socket
+ * @param link The link
+ * @param data What to send
+ * @param size How many bytes
+ * @return false if the other end has gone away
+ */
+static bool socket_send(domain_link * link, const void * data, size_t size) {
+
+    const char * at = data;
+
+    while (size > 0) {
+        ssize_t sent = send(link->fd, at, size, DOMAIN_SEND_FLAGS);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        at += sent;
+        size -= (size_t) sent;
+    }
+
+    return true;
+
+}
+
+
+/**
+ * Receive exactly a number of bytes from a socket
+ * @param link The link
+ * @param data Where to put them
+ * @param size How many bytes
+ * @return false if the other end has gone away
+ */
+static bool socket_receive(domain_link * link, void * data, size_t size) {
+
+    char * at = data;
+
+    while (size > 0) {
+        ssize_t got = recv(link->fd, at, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        at += got;
+        size -= (size_t) got;
+    }
+
+    return true;
+
+}
+
+
+/**
+ * Close one end of a socket link
+ * @param link The link
+ */
+static void socket_close(domain_link * link) {
+
+    close(link->fd);
+
+}
+
+
+/**
+ * The transport for processes on one machine, a Unix socket pair
+ * @param a One end
+ * @param b The other end
+ * @return false if the sockets couldn't be made
+ */
+bool domain_socket_pair(domain_link * a, domain_link * b) {
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) return false;
+
+    a->send = b->send = socket_send;
+    a->receive = b->receive = socket_receive;
+    a->close = b->close = socket_close;
+    a->fd = fds[0];
+    b->fd = fds[1];
+
+    return true;
+
+}
+
+
+// The part of the garden one process owns, and its links to the processes either side
+// Rows from to middle are actioned in the first half of a round and middle to to in the second
+typedef struct {
+
+    int from;
+    int middle;
+    int to;
+
+    // How many rows past its own a process can reach into, and keeps a copy of
+    int reach;
+
+    // NULL for the first and last strips
+    domain_link * up;
+    domain_link * down;
+
+    // Room for 2 * reach rows
+    cell * rows;
+
+} domain_strip;
+
+
+/**
+ * Action every inhabitant in some rows, in the usual order
+ * @param sim The simulation
+ * @param from The first row
+ * @param to The row after the last one
+ */
+static void run_rows(simulation * sim, const int from, const int to) {
+
+    garden_walk walk;
+
+    sim_walk_area(sim, &walk, (int[2]) {from, 0}, (int[2]) {to, sim->y});
+    while (sim_walk_next(sim, &walk))
+        inhabitant_action(sim, walk.pos);
+    sim_walk_end(&walk);
+
+}
+
+
+/**
+ * Pass the rows either side of the boundary between two strips from one to the other
+ * These are the rows both keep a copy of, and only the sender has changed them since
+ * they last agreed
+ * @param sim The simulation
+ * @param strip The strip of this process
+ * @param link The link to send down, NULL if this process is receiving
+ * @param other The link to receive from, NULL if this process is sending
+ * @param boundary The first row of the lower of the two strips
+ * @return false if the other process has gone away
+ */
+static bool pass_boundary(simulation * sim, domain_strip * strip, domain_link * link, domain_link * other,
+                          const int boundary) {
+
+    int from = boundary - strip->reach;
+    int to = boundary + strip->reach;
+    size_t size = (size_t) (to - from) * (size_t) sim->y * sizeof(cell);
+
+    if (link != NULL) {
+        sim_get_rows(sim, from, to, strip->rows);
+        return link->send(link, strip->rows, size);
+    }
+
+    if (!other->receive(other, strip->rows, size)) return false;
+    sim_put_rows(sim, from, to, strip->rows);
+    return true;
+
+}
+
+
+/**
+ * Run one round of a strip
+ * Frogs can reach half a strip at most, so the first halves of every strip can be run at
+ * once without two processes ever touching the same cell, and then the second halves.
+ * Between and after the halves, each process passes on the rows by its boundaries that it
+ * has just changed. A process sends before it receives, and the messages all go the same
+ * way along the strips, so the first (or last) strip is always free to take its message
+ * and nothing waits in a circle
+ * Every process then settles the rows it has a copy of, and as they all start from the
+ * same cells they all settle them the same way
+ * @param sim The simulation
+ * @param strip The strip
+ * @return false if another process has gone away
+ */
+static bool strip_round(simulation * sim, domain_strip * strip) {
+
+    run_rows(sim, strip->from, strip->middle);
+
+    if (strip->up != NULL && !pass_boundary(sim, strip, strip->up, NULL, strip->from)) return false;
+    if (strip->down != NULL && !pass_boundary(sim, strip, NULL, strip->down, strip->to)) return false;
+
+    run_rows(sim, strip->middle, strip->to);
+
+    if (strip->down != NULL && !pass_boundary(sim, strip, strip->down, NULL, strip->to)) return false;
+    if (strip->up != NULL && !pass_boundary(sim, strip, NULL, strip->up, strip->from)) return false;
+
+    int from = strip->up != NULL ? strip->from - strip->reach : strip->from;
+    int to = strip->down != NULL ? strip->to + strip->reach : strip->to;
+    sim_settle_rows(sim, from, to);
+
+    return true;
+
+}
+
+
+/**
+ * Run a number of rounds of a garden split between processes, and gather it back
+ * Each of PROCESSES processes owns a strip of rows, and keeps a copy of the rows of the
+ * strips either side as far as a frog can see. The processes are forked, so they all start
+ * with the whole garden and only ever copy the pages of their own strip. Each has its own
+ * random numbers seeded from the simulation's, so the result only depends on the seed and
+ * the number of processes, but isn't the same as running on one process
+ *
+ * Only in-memory row-major gardens that don't wrap are split, into strips at least four
+ * times as tall as frogs can see, so that each half strip is out of reach of the next
+ * @param sim The simulation, left at the round after the last one
+ * @param rounds How many rounds
+ * @param transport How the processes talk to each other
+ * @return false if nothing was done, and the rounds should be run here instead
+ */
+bool domain_run(simulation * sim, const int rounds, const domain_transport transport) {
+
+    int ranks = sim->config->PROCESSES;
+    if (ranks <= 1 || rounds <= 0) return false;
+    if (sim->garden == NULL || sim->file != NULL || sim->tiled || sim->wrap) return false;
+
+    int reach = sim->config->FROG_VISION_DISTANCE > 1 ? sim->config->FROG_VISION_DISTANCE : 1;
+    if (sim->x / ranks < 4 * reach) return false;
+
+    // Links 4k and 4k + 1 join strips k and k + 1, 4k + 2 and 4k + 3 join this process and
+    // strip k + 1, for gathering at the end. Each link is only kept by the process that uses it
+    int count = 4 * (ranks - 1);
+    domain_link * links = malloc(count * sizeof(domain_link));
+    int * owner = malloc(count * sizeof(int));
+    pid_t * children = malloc(ranks * sizeof(pid_t));
+
+    int made = 0;
+    while (made < count && transport(&links[made], &links[made + 1])) made += 2;
+
+    for (int k = 0; k + 1 < ranks; k++) {
+        owner[4 * k] = k;
+        owner[4 * k + 1] = k + 1;
+        owner[4 * k + 2] = 0;
+        owner[4 * k + 3] = k + 1;
+    }
+
+    if (made < count) {
+        for (int n = 0; n < made; n++) links[n].close(&links[n]);
+        free(links);
+        free(owner);
+        free(children);
+        return false;
+    }
+
+    uint64_t seed = random_bits(&sim->rng);
+    int rank = 0;
+
+    // Nothing left unwritten for the children to write out again
+    // If a fork fails, closing its links below stops the processes either side of it too
+    fflush(stdout);
+    for (int k = 1; k < ranks; k++) {
+        children[k] = fork();
+        if (children[k] == 0) {
+            rank = k;
+            break;
+        }
+    }
+
+    for (int n = 0; n < count; n++)
+        if (owner[n] != rank) links[n].close(&links[n]);
+
+    domain_strip strip;
+    strip.from = (int) ((long) sim->x * rank / ranks);
+    strip.to = (int) ((long) sim->x * (rank + 1) / ranks);
+    strip.middle = strip.from + (strip.to - strip.from) / 2;
+    strip.reach = reach;
+    strip.up = rank > 0 ? &links[4 * (rank - 1) + 1] : NULL;
+    strip.down = rank + 1 < ranks ? &links[4 * rank] : NULL;
+
+    int buffered = 2 * reach > DOMAIN_GATHER_ROWS ? 2 * reach : DOMAIN_GATHER_ROWS;
+    strip.rows = malloc((size_t) buffered * (size_t) sim->y * sizeof(cell));
+
+    random_seed(&sim->rng, seed ^ mix64((uint64_t) rank));
+    skip_counter_init(&sim->lettuce_grow);
+    skip_counter_init(&sim->slug_reproduce);
+    skip_counter_init(&sim->frog_reproduce);
+
+    bool ok = true;
+    for (int r = 0; ok && r < rounds; r++) ok = strip_round(sim, &strip);
+
+    // Every other strip sends its own rows home, a few at a time
+    if (rank > 0) {
+        domain_link * home = &links[4 * (rank - 1) + 3];
+        for (int x = strip.from; ok && x < strip.to; x += DOMAIN_GATHER_ROWS) {
+            int end = x + DOMAIN_GATHER_ROWS < strip.to ? x + DOMAIN_GATHER_ROWS : strip.to;
+            sim_get_rows(sim, x, end, strip.rows);
+            ok = home->send(home, strip.rows, (size_t) (end - x) * (size_t) sim->y * sizeof(cell));
+        }
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    for (int k = 1; ok && k < ranks; k++) {
+        domain_link * home = &links[4 * (k - 1) + 2];
+        int from = (int) ((long) sim->x * k / ranks);
+        int to = (int) ((long) sim->x * (k + 1) / ranks);
+        for (int x = from; ok && x < to; x += DOMAIN_GATHER_ROWS) {
+            int end = x + DOMAIN_GATHER_ROWS < to ? x + DOMAIN_GATHER_ROWS : to;
+            ok = home->receive(home, strip.rows, (size_t) (end - x) * (size_t) sim->y * sizeof(cell));
+            if (ok) sim_put_rows(sim, x, end, strip.rows);
+        }
+    }
+
+    for (int n = 0; n < count; n++)
+        if (owner[n] == 0) links[n].close(&links[n]);
+    for (int k = 1; k < ranks; k++)
+        if (children[k] > 0) waitpid(children[k], NULL, 0);
+
+    if (!ok) printf("A garden process stopped early, so the garden is only partly up to date\n");
+
+    sim->round += rounds;
+
+    free(strip.rows);
+    free(links);
+    free(owner);
+    free(children);
+
+    return true;
+
+}
+
+#else
+
+// No fork, so every round is run in this process
+bool domain_socket_pair(domain_link * a, domain_link * b) {
+    (void) a;
+    (void) b;
+    return false;
+}
+
+bool domain_run(simulation * sim, const int rounds, const domain_transport transport) {
+    (void) sim;
+    (void) rounds;
+    (void) transport;
+    return false;
+}
+
+#endif
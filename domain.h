@@ -0,0 +1,46 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_DOMAIN_H
+#define GARDEN_PARADISE_DOMAIN_H
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Rows sent at a time when the strips are gathered back at the end
+#define DOMAIN_GATHER_ROWS 64
+
+
+// One end of a connection between two garden processes
+// A transport fills in how to send and receive, nothing else cares how it is done
+typedef struct DOMAIN_LINK domain_link;
+
+struct DOMAIN_LINK {
+
+    // Both block until all of size has gone, false if the other end has gone away
+    bool (* send)(domain_link * link, const void * data, size_t size);
+    bool (* receive)(domain_link * link, void * data, size_t size);
+    void (* close)(domain_link * link);
+
+    // The socket, for the socket transport
+    int fd;
+
+};
+
+// Makes both ends of a new connection, before the processes are started
+typedef bool (* domain_transport)(domain_link * a, domain_link * b);
+
+
+// Domain functions
+bool domain_socket_pair(domain_link * a, domain_link * b);
+bool domain_run(simulation * sim, int rounds, domain_transport transport);
+
+
+#endif //GARDEN_PARADISE_DOMAIN_H
@@ -0,0 +1,770 @@
+//
+// Created on 19/10/2026.
+//
+
+// pthreads and pinning threads to CPUs are not part of standard C
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+
+#include "engine.h"
+#include "inhabitant.h"
+#include "simulation.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Tiles a worker has been given for the current phase, taken from the bottom by the worker
+// and stolen from the top by the others. Nothing is added during a phase, so both ends
+// are packed into one word, top in the high half, and every take is one compare and swap
+typedef struct {
+
+    int * tiles;
+    _Atomic uint64_t ends;
+
+} tile_deque;
+
+
+// What each worker thread is started with
+typedef struct {
+
+    round_engine * engine;
+    int index;
+
+} engine_worker;
+
+
+// A pool of workers that runs the rounds of one simulation a tile at a time
+// The calling thread is worker 0, so there are workers - 1 threads
+struct ROUND_ENGINE {
+
+    simulation * sim;
+
+    int workers;
+    pthread_t * threads;
+    engine_worker * args;
+
+    int tiles_x;
+    int tiles_y;
+
+    // NUMA nodes the workers are spread over. Each node owns a band of rows of tiles,
+    // the memory under them and the workers that run them, numbered together
+    int nodes;
+    int * worker_node;
+    // First worker and first row of tiles of each node, then the number of each
+    int * node_worker;
+    int * node_band;
+    // Node that owns each row of tiles
+    int * row_node;
+    // CPU each worker is pinned to, -1 if it isn't
+    int * cpu;
+    // How far a turn can look, for counting the turns that read another node's rows
+    int reach;
+
+    // How many inhabitants each tile actioned last round, the guess at what it costs this round
+    uint32_t * cost;
+
+    tile_deque * deques;
+    // Scratch space for sharing out the tiles of a phase
+    uint64_t * order;
+    uint64_t * load;
+    int * sizes;
+
+    // Every tile's random numbers this round come from this
+    uint64_t round_seed;
+    // All the tiles are run at once, with inhabitants claiming cells as they go
+    bool async;
+    // Changes each worker has made to the state hash this round
+    uint64_t * hash;
+    // Births and meals on each worker this round, for the series
+    int * births;
+    int * meals;
+    // Turns each worker has run this round, and how many of them looked into another node's rows
+    uint64_t * turns;
+    uint64_t * halo;
+
+    // Set while the workers are copying the garden into memory on their own node
+    cell * block;
+    size_t block_size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    // Goes up by one for every phase, so the workers know to start
+    unsigned long generation;
+    // Workers still running the current phase
+    int busy;
+    bool quit;
+
+};
+
+
+/**
+ * Take a tile from a deque
+ * @param deque The deque
+ * @param own True for the worker that owns it, which takes from the bottom
+ * @return The tile, -1 if the deque is empty
+ */
+static int deque_take(tile_deque * deque, const bool own) {
+
+    uint64_t ends = atomic_load_explicit(&deque->ends, memory_order_acquire);
+
+    for (;;) {
+        uint32_t top = (uint32_t) (ends >> 32);
+        uint32_t bottom = (uint32_t) ends;
+        if (top >= bottom) return -1;
+
+        uint64_t next = own ? (uint64_t) top << 32 | (bottom - 1) : (uint64_t) (top + 1) << 32 | bottom;
+        if (atomic_compare_exchange_weak_explicit(&deque->ends, &ends, next,
+                                                  memory_order_acq_rel, memory_order_acquire))
+            return deque->tiles[own ? bottom - 1 : top];
+    }
+
+}
+
+
+/**
+ * Find which node owns a row of tiles
+ * @param engine The engine
+ * @param tx The row of tiles, may be one off either end
+ * @return The node, the nearest row's node off the end of a garden that doesn't wrap
+ */
+static int engine_row_node(const round_engine * engine, int tx) {
+
+    if (tx < 0) tx = engine->sim->wrap ? engine->tiles_x - 1 : 0;
+    if (tx >= engine->tiles_x) tx = engine->sim->wrap ? 0 : engine->tiles_x - 1;
+
+    return engine->row_node[tx];
+
+}
+
+
+/**
+ * Action every inhabitant in a tile
+ * The tile gets its own copy of the simulation struct, sharing the garden, with its own
+ * random numbers and skip counters seeded from the tile, so a tile does the same thing
+ * whichever worker runs it and whatever else is running
+ * In an async round an inhabitant only takes its turn if it can claim its cell first, as
+ * one that has moved in from a neighbouring tile may have beaten it there
+ * @param engine The engine
+ * @param worker The worker running the tile
+ * @param tile The tile, tile x * tiles_y + tile y
+ */
+static void engine_tile(round_engine * engine, const int worker, const int tile) {
+
+    simulation view = * engine->sim;
+
+    view.hash = 0;
+    view.births = 0;
+    view.meals = 0;
+    view.async = engine->async;
+    random_seed(&view.rng, engine->round_seed ^ mix64((uint64_t) tile));
+    skip_counter_init(&view.lettuce_grow);
+    skip_counter_init(&view.slug_reproduce);
+    skip_counter_init(&view.frog_reproduce);
+
+    int tx = tile / engine->tiles_y;
+    int from[2] = {tx << ENGINE_TILE_BITS, (tile % engine->tiles_y) << ENGINE_TILE_BITS};
+    int to[2] = {from[0] + ENGINE_TILE_SIZE, from[1] + ENGINE_TILE_SIZE};
+
+    // Turns taken this close to a band of rows owned by another node look into its memory
+    int node = engine->row_node[tx];
+    int last = (to[0] < view.x ? to[0] : view.x) - 1;
+    int near_low = engine_row_node(engine, tx - 1) != node ? from[0] + engine->reach : from[0];
+    int near_high = engine_row_node(engine, tx + 1) != node ? last - engine->reach : last;
+
+    uint32_t actions = 0;
+    uint32_t halo = 0;
+
+    garden_walk walk;
+    sim_walk_area(&view, &walk, from, to);
+    while (sim_walk_next(&view, &walk)) {
+        if (view.async && !sim_claim(&view, walk.pos)) continue;
+        inhabitant_action(&view, walk.pos);
+        actions++;
+        halo += walk.pos[0] < near_low || walk.pos[0] > near_high;
+    }
+    sim_walk_end(&walk);
+
+    engine->cost[tile] = actions;
+    engine->hash[worker] ^= view.hash;
+    engine->births[worker] += view.births;
+    engine->meals[worker] += view.meals;
+    engine->turns[worker] += actions;
+    engine->halo[worker] += halo;
+
+}
+
+
+/**
+ * Run tiles until there are none left in any deque
+ * A worker empties its own deque first, then steals from the others in turn, starting with
+ * the workers on its own node. No tiles are added during a phase, so once every deque has
+ * been found empty the phase is done
+ * @param engine The engine
+ * @param worker The worker
+ */
+static void engine_work(round_engine * engine, const int worker) {
+
+    int node = engine->worker_node[worker];
+
+    for (;;) {
+        int tile = deque_take(&engine->deques[worker], true);
+
+        for (int pass = 0; tile < 0 && pass < 2; pass++)
+            for (int n = 1; tile < 0 && n < engine->workers; n++) {
+                int victim = (worker + n) % engine->workers;
+                if ((engine->worker_node[victim] == node) == (pass == 0))
+                    tile = deque_take(&engine->deques[victim], false);
+            }
+
+        if (tile < 0) return;
+
+        engine_tile(engine, worker, tile);
+    }
+
+}
+
+
+/**
+ * Copy a worker's share of the garden into the new block, so its first touch of those
+ * pages comes from the node that owns them and the kernel puts them there
+ * The rows of each node's band are split evenly between the node's workers, and the first
+ * and last workers take the border above and below the garden too
+ * @param engine The engine
+ * @param worker The worker
+ */
+static void engine_touch(round_engine * engine, const int worker) {
+
+    simulation * sim = engine->sim;
+    int node = engine->worker_node[worker];
+
+    int start = engine->node_band[node] << ENGINE_TILE_BITS;
+    int end = engine->node_band[node + 1] << ENGINE_TILE_BITS;
+    if (end > sim->x) end = sim->x;
+    int share = worker - engine->node_worker[node];
+    int shares = engine->node_worker[node + 1] - engine->node_worker[node];
+
+    size_t from = worker == 0 ? 0 : sim_garden_offset(sim, start + (end - start) * share / shares);
+    size_t to = worker == engine->workers - 1 ? engine->block_size
+                                              : sim_garden_offset(sim, start + (end - start) * (share + 1) / shares);
+
+    cell * old;
+    sim_garden_block(sim, &old);
+    if (to > from) memcpy(engine->block + from, old + from, (to - from) * sizeof(cell));
+
+}
+
+
+/**
+ * Do whatever the workers have been woken up for
+ * @param engine The engine
+ * @param worker The worker
+ */
+static void engine_job(round_engine * engine, const int worker) {
+
+    if (engine->block != NULL) engine_touch(engine, worker);
+    else engine_work(engine, worker);
+
+}
+
+
+/**
+ * Pin a worker to its CPU, if it has one
+ * The calling thread is worker 0, and is only pinned while engine_run has it
+ * @param engine The engine
+ * @param worker The worker, which must be the thread calling this
+ */
+static void engine_pin(const round_engine * engine, const int worker) {
+
+#if defined(__linux__)
+    if (engine->cpu[worker] < 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(engine->cpu[worker], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void) engine;
+    (void) worker;
+#endif
+
+}
+
+
+/**
+ * Body of every worker thread other than the caller's
+ * @param arg The engine_worker
+ * @return NULL
+ */
+static void * engine_thread(void * arg) {
+
+    engine_worker * self = arg;
+    round_engine * engine = self->engine;
+    unsigned long seen = 0;
+
+    engine_pin(engine, self->index);
+
+    for (;;) {
+        pthread_mutex_lock(&engine->lock);
+        while (engine->generation == seen && !engine->quit)
+            pthread_cond_wait(&engine->wake, &engine->lock);
+        seen = engine->generation;
+        bool quit = engine->quit;
+        pthread_mutex_unlock(&engine->lock);
+
+        if (quit) return NULL;
+
+        engine_job(engine, self->index);
+
+        pthread_mutex_lock(&engine->lock);
+        if (--engine->busy == 0) pthread_cond_signal(&engine->done);
+        pthread_mutex_unlock(&engine->lock);
+    }
+
+}
+
+
+/**
+ * Wake the workers for a job and join in as worker 0, returning once they have all finished
+ * @param engine The engine
+ */
+static void engine_run(round_engine * engine) {
+
+    // The calling thread goes back to the CPUs it had, so nothing it starts later is stuck on one
+#if defined(__linux__)
+    cpu_set_t caller;
+    bool pinned = engine->cpu[0] >= 0 && !pthread_getaffinity_np(pthread_self(), sizeof(caller), &caller);
+    if (pinned) engine_pin(engine, 0);
+#endif
+
+    pthread_mutex_lock(&engine->lock);
+    engine->busy = engine->workers;
+    engine->generation++;
+    pthread_cond_broadcast(&engine->wake);
+    pthread_mutex_unlock(&engine->lock);
+
+    engine_job(engine, 0);
+
+    pthread_mutex_lock(&engine->lock);
+    engine->busy--;
+    while (engine->busy > 0) pthread_cond_wait(&engine->done, &engine->lock);
+    pthread_mutex_unlock(&engine->lock);
+
+#if defined(__linux__)
+    if (pinned) pthread_setaffinity_np(pthread_self(), sizeof(caller), &caller);
+#endif
+
+}
+
+
+/**
+ * Compare two packed cost and tile words, largest cost first
+ * @param a Pointer to the first word
+ * @param b Pointer to the second word
+ * @return qsort ordering
+ */
+static int cost_compare(const void * a, const void * b) {
+
+    uint64_t c1 = * (const uint64_t *) a;
+    uint64_t c2 = * (const uint64_t *) b;
+
+    return c1 < c2 ? 1 : c1 > c2 ? -1 : 0;
+
+}
+
+
+/**
+ * Run one phase of a round, every tile of one colour
+ * Tiles are coloured in a 2x2 pattern, so tiles of the same colour have a whole tile
+ * between them and can't reach each other's cells. An async round is one phase of every tile
+ * The tiles are shared out most expensive first, each to the worker on the tile's node with
+ * the least so far, going by last round's costs. Each worker starts on its most expensive
+ * tile and the cheap ones are left at the top of its deque for anyone who runs out
+ * @param engine The engine
+ * @param phase The colour, 0 to 3
+ * @param step 2 to run one colour, 1 for every tile
+ */
+static void engine_phase(round_engine * engine, const int phase, const int step) {
+
+    int count = 0;
+    for (int tx = phase >> 1; tx < engine->tiles_x; tx += step)
+        for (int ty = phase & 1; ty < engine->tiles_y; ty += step) {
+            int tile = tx * engine->tiles_y + ty;
+            // Empty tiles still have to be looked at, so they cost something
+            engine->order[count++] = (uint64_t) (engine->cost[tile] + 1) << 32 | (uint32_t) tile;
+        }
+
+    if (count == 0) return;
+
+    qsort(engine->order, count, sizeof(uint64_t), cost_compare);
+
+    int * sizes = engine->sizes;
+    for (int w = 0; w < engine->workers; w++) {
+        engine->load[w] = 0;
+        sizes[w] = 0;
+    }
+
+    for (int n = 0; n < count; n++) {
+        int node = engine->row_node[(int) (uint32_t) engine->order[n] / engine->tiles_y];
+        int least = engine->node_worker[node];
+        for (int w = least + 1; w < engine->node_worker[node + 1]; w++)
+            if (engine->load[w] < engine->load[least]) least = w;
+
+        engine->deques[least].tiles[sizes[least]++] = (int) (uint32_t) engine->order[n];
+        engine->load[least] += engine->order[n] >> 32;
+    }
+
+    // Most expensive at the bottom, where the owner takes from
+    for (int w = 0; w < engine->workers; w++) {
+        int * list = engine->deques[w].tiles;
+        for (int i = 0, j = sizes[w] - 1; i < j; i++, j--) {
+            int swap = list[i];
+            list[i] = list[j];
+            list[j] = swap;
+        }
+        atomic_store_explicit(&engine->deques[w].ends, (uint64_t) sizes[w], memory_order_relaxed);
+    }
+
+    engine_run(engine);
+
+}
+
+
+/**
+ * Read a list of numbers such as "0-3,8-11", the way /sys lists nodes and CPUs
+ * @param path The file
+ * @param out Where to put the numbers
+ * @param max How many fit
+ * @return How many were read, 0 if there is no such file
+ */
+static int read_number_list(const char * path, int * out, const int max) {
+
+    FILE * file = fopen(path, "r");
+    if (file == NULL) return 0;
+
+    int count = 0;
+    int first;
+    while (fscanf(file, "%d", &first) == 1) {
+        int last = first;
+        if (fscanf(file, "-%d", &last) != 1) last = first;
+        for (int n = first; n <= last && count < max; n++) out[count++] = n;
+        if (fscanf(file, ",") == EOF) break;
+    }
+
+    fclose(file);
+    return count;
+
+}
+
+
+/**
+ * Spread the workers over the NUMA nodes, and give the nodes bands of rows of tiles
+ * Nodes and their CPUs come from /sys, leaving out CPUs this process can't run on and
+ * nodes with none of them. There are never more nodes used than workers or rows of tiles.
+ * Workers are pinned to a CPU of their node if every node has a CPU for each of its workers
+ * Without /sys there is one node, and nothing is pinned
+ * @param engine The engine
+ */
+static void engine_topology(round_engine * engine) {
+
+    int workers = engine->workers;
+    int nodes = 1;
+
+    for (int w = 0; w < workers; w++) engine->cpu[w] = -1;
+
+#if defined(__linux__)
+    cpu_set_t allowed;
+    int * ids = malloc(CPU_SETSIZE * sizeof(int));
+    // Every node's CPUs one after another, and where each node's start
+    int * cpus = malloc(CPU_SETSIZE * sizeof(int));
+    int * starts = malloc((CPU_SETSIZE + 1) * sizeof(int));
+    int found = 0;
+    int total = 0;
+
+    // The process's own CPUs, as the main thread has them, not whatever this thread is on
+    if (!sched_getaffinity(getpid(), sizeof(allowed), &allowed)) {
+        int listed = read_number_list("/sys/devices/system/node/online", ids, CPU_SETSIZE);
+
+        for (int n = 0; n < listed; n++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", ids[n]);
+
+            int count = read_number_list(path, cpus + total, CPU_SETSIZE - total);
+            int kept = 0;
+            for (int c = 0; c < count; c++)
+                if (cpus[total + c] < CPU_SETSIZE && CPU_ISSET(cpus[total + c], &allowed))
+                    cpus[total + kept++] = cpus[total + c];
+
+            // Nodes with only memory, or none of our CPUs
+            if (kept == 0) continue;
+            starts[found++] = total;
+            total += kept;
+        }
+        starts[found] = total;
+    }
+
+    if (found > 0) {
+        nodes = found < workers ? found : workers;
+        if (nodes > engine->tiles_x) nodes = engine->tiles_x;
+
+        bool enough = true;
+        for (int k = 0; k < nodes; k++)
+            if (starts[k + 1] - starts[k] < ((k + 1) * workers + nodes - 1) / nodes - (k * workers + nodes - 1) / nodes)
+                enough = false;
+
+        for (int w = 0; enough && w < workers; w++) {
+            int node = w * nodes / workers;
+            int first = (node * workers + nodes - 1) / nodes;
+            engine->cpu[w] = cpus[starts[node] + w - first];
+        }
+    }
+
+    free(ids);
+    free(cpus);
+    free(starts);
+#endif
+
+    engine->nodes = nodes;
+
+    // Workers w * nodes / workers and rows of tiles tx * nodes / tiles_x are on each node
+    for (int w = 0; w < workers; w++) engine->worker_node[w] = w * nodes / workers;
+    for (int tx = 0; tx < engine->tiles_x; tx++) engine->row_node[tx] = tx * nodes / engine->tiles_x;
+    for (int k = 0; k <= nodes; k++) {
+        engine->node_worker[k] = (k * workers + nodes - 1) / nodes;
+        engine->node_band[k] = (k * engine->tiles_x + nodes - 1) / nodes;
+    }
+
+}
+
+
+/**
+ * Start the workers for a simulation
+ * @param sim The simulation
+ * @param workers How many, including the calling thread
+ * @return The engine
+ */
+static round_engine * engine_create(simulation * sim, const int workers) {
+
+    round_engine * out = malloc(sizeof(round_engine));
+
+    out->sim = sim;
+    out->workers = workers;
+    out->async = false;
+
+    out->tiles_x = (sim->x + ENGINE_TILE_SIZE - 1) >> ENGINE_TILE_BITS;
+    out->tiles_y = (sim->y + ENGINE_TILE_SIZE - 1) >> ENGINE_TILE_BITS;
+    int tiles = out->tiles_x * out->tiles_y;
+
+    out->cost = calloc(tiles, sizeof(uint32_t));
+    out->order = malloc(tiles * sizeof(uint64_t));
+    out->load = malloc(workers * sizeof(uint64_t));
+    out->sizes = malloc(workers * sizeof(int));
+    out->hash = calloc(workers, sizeof(uint64_t));
+    out->births = calloc(workers, sizeof(int));
+    out->meals = calloc(workers, sizeof(int));
+    out->turns = calloc(workers, sizeof(uint64_t));
+    out->halo = calloc(workers, sizeof(uint64_t));
+
+    out->worker_node = malloc(workers * sizeof(int));
+    out->node_worker = malloc((workers + 1) * sizeof(int));
+    out->node_band = malloc((workers + 1) * sizeof(int));
+    out->row_node = malloc(out->tiles_x * sizeof(int));
+    out->cpu = malloc(workers * sizeof(int));
+    out->reach = 1;
+    engine_topology(out);
+
+    out->deques = malloc(workers * sizeof(tile_deque));
+    for (int w = 0; w < workers; w++) {
+        out->deques[w].tiles = malloc(tiles * sizeof(int));
+        atomic_init(&out->deques[w].ends, 0);
+    }
+
+    pthread_mutex_init(&out->lock, NULL);
+    pthread_cond_init(&out->wake, NULL);
+    pthread_cond_init(&out->done, NULL);
+    out->generation = 0;
+    out->busy = 0;
+    out->quit = false;
+
+    out->threads = malloc(workers * sizeof(pthread_t));
+    out->args = malloc(workers * sizeof(engine_worker));
+    for (int w = 1; w < workers; w++) {
+        out->args[w].engine = out;
+        out->args[w].index = w;
+        pthread_create(&out->threads[w], NULL, engine_thread, &out->args[w]);
+    }
+
+    // The garden was first touched by whoever made it, so is all on one node. Blocks this
+    // big come straight from mmap with no pages yet, so each worker copying its own share
+    // across puts every band of rows on the node that owns it
+    out->block = NULL;
+    cell * old;
+    out->block_size = sim_garden_block(sim, &old);
+    if (out->nodes > 1 && old != NULL) {
+        out->block = malloc(out->block_size * sizeof(cell));
+        engine_run(out);
+        sim_move_garden(sim, out->block);
+        out->block = NULL;
+    }
+
+    return out;
+
+}
+
+
+/**
+ * Stop the workers of an engine and free it
+ * @param engine The engine, may be NULL
+ */
+void engine_free(round_engine * engine) {
+
+    if (engine == NULL) return;
+
+    pthread_mutex_lock(&engine->lock);
+    engine->quit = true;
+    pthread_cond_broadcast(&engine->wake);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (int w = 1; w < engine->workers; w++) pthread_join(engine->threads[w], NULL);
+
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->wake);
+    pthread_cond_destroy(&engine->done);
+
+    for (int w = 0; w < engine->workers; w++) free(engine->deques[w].tiles);
+    free(engine->deques);
+    free(engine->threads);
+    free(engine->args);
+    free(engine->cost);
+    free(engine->order);
+    free(engine->load);
+    free(engine->sizes);
+    free(engine->hash);
+    free(engine->births);
+    free(engine->meals);
+    free(engine->turns);
+    free(engine->halo);
+    free(engine->worker_node);
+    free(engine->node_worker);
+    free(engine->node_band);
+    free(engine->row_node);
+    free(engine->cpu);
+    free(engine);
+
+}
+
+
+/**
+ * Action every inhabitant of a simulation on THREADS workers, if the garden allows it
+ * The garden is split into tiles, and the tiles are run in four phases by colour. Inside
+ * a tile inhabitants take their turns in row-major order, as in a normal round, but the
+ * tiles run in no particular order. Each tile has its own random numbers, so the result
+ * only depends on the seed, not on how many workers there are or which ran what.
+ * It isn't the same result as a round on one thread, which runs the whole garden in order
+ *
+ * Sparse gardens allocate chunks as they go, so aren't run in parallel. Neither are gardens
+ * where frogs see half a tile or more, or wrap-around gardens that aren't a whole, even
+ * number of tiles across, as two tiles of the same colour could then reach the same cells
+ *
+ * With ASYNC_ROUNDS every tile runs at once instead, whatever the vision or wrap. Each
+ * inhabitant claims its cell, and every cell it moves, eats or breeds into, with a compare
+ * and swap, and if another worker has changed the cell since it looked it stays put instead
+ * (see sim_take). Nothing waits for anything, but the result depends on timing
+ * @param sim The simulation
+ * @return false if nothing was done, and the round should be run on this thread instead
+ */
+bool engine_round(simulation * sim) {
+
+    int workers = sim->config->THREADS;
+    if (workers <= 1 || sim->chunks != NULL) return false;
+
+    bool async = sim->config->ASYNC_ROUNDS;
+    int reach = sim->config->FROG_VISION_DISTANCE > 1 ? sim->config->FROG_VISION_DISTANCE : 1;
+    if (!async && 2 * reach >= ENGINE_TILE_SIZE) return false;
+    if (!async && sim->wrap && (sim->x % (2 * ENGINE_TILE_SIZE) || sim->y % (2 * ENGINE_TILE_SIZE))) return false;
+
+    if (sim->engine != NULL && sim->engine->workers != workers) {
+        engine_free(sim->engine);
+        sim->engine = NULL;
+    }
+    if (sim->engine == NULL) sim->engine = engine_create(sim, workers);
+
+    round_engine * engine = sim->engine;
+
+    engine->round_seed = random_bits(&sim->rng);
+    engine->async = async;
+    engine->reach = reach < ENGINE_TILE_SIZE ? reach : ENGINE_TILE_SIZE;
+    for (int w = 0; w < workers; w++) {
+        engine->hash[w] = 0;
+        engine->births[w] = 0;
+        engine->meals[w] = 0;
+        engine->turns[w] = 0;
+        engine->halo[w] = 0;
+    }
+
+    if (async) engine_phase(engine, 0, 1);
+    else for (int phase = 0; phase < 4; phase++) engine_phase(engine, phase, 2);
+
+    for (int w = 0; w < workers; w++) {
+        sim->hash ^= engine->hash[w];
+        sim->births += engine->births[w];
+        sim->meals += engine->meals[w];
+    }
+
+    return true;
+
+}
+
+
+/**
+ * Print how the last parallel round went, if there was one
+ * Turns that looked across into a band of rows owned by another node read memory on that
+ * node, so these are the turns that paid for the trip between sockets
+ * @param sim The simulation
+ */
+void engine_print_stats(const simulation * sim) {
+
+    round_engine * engine = sim->engine;
+    if (engine == NULL) return;
+
+    uint64_t turns = 0;
+    uint64_t halo = 0;
+    for (int w = 0; w < engine->workers; w++) {
+        turns += engine->turns[w];
+        halo += engine->halo[w];
+    }
+
+    printf("%d threads on %d NUMA node%s%s, %llu of %llu turns looked across nodes\n",
+           engine->workers, engine->nodes, engine->nodes == 1 ? "" : "s",
+           engine->cpu[0] >= 0 ? " (pinned)" : "",
+           (unsigned long long) halo, (unsigned long long) turns);
+
+}
+
+#else
+
+// No pthreads, so every round is run on one thread
+bool engine_round(simulation * sim) {
+    (void) sim;
+    return false;
+}
+
+void engine_free(round_engine * engine) {
+    (void) engine;
+}
+
+void engine_print_stats(const simulation * sim) {
+    (void) sim;
+}
+
+#endif
@@ -0,0 +1,30 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_ENGINE_H
+#define GARDEN_PARADISE_ENGINE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Parallel rounds split the garden into ENGINE_TILE_SIZE x ENGINE_TILE_SIZE tiles
+// A whole number of occupancy words wide, so tiles never share one with a tile two along
+#define ENGINE_TILE_BITS 6
+#define ENGINE_TILE_SIZE (1 << ENGINE_TILE_BITS)
+
+
+// Engine functions
+bool engine_round(simulation * sim);
+void engine_free(round_engine * engine);
+void engine_print_stats(const simulation * sim);
+
+
+#endif //GARDEN_PARADISE_ENGINE_H
@@ -0,0 +1,240 @@
+//
+// Created on 19/10/2026.
+//
+
+#include <string.h>
+
+#include "ensemble.h"
+#include "simulation.h"
+
+
+/**
+ * Add a number to a running mean and variance
+ * Welford's method, which doesn't lose precision the way a sum of squares does
+ * @param w The running totals
+ * @param value The number
+ */
+void welford_add(welford * w, const double value) {
+
+    w->count++;
+    double delta = value - w->mean;
+    w->mean += delta / (double) w->count;
+    w->m2 += delta * (value - w->mean);
+
+}
+
+
+/**
+ * Add the numbers of one running mean and variance to another, as if they were one stream
+ * @param into The totals to add to
+ * @param from The totals to add, left alone
+ */
+void welford_merge(welford * into, const welford * from) {
+
+    if (from->count == 0) return;
+    if (into->count == 0) {
+        * into = * from;
+        return;
+    }
+
+    double count = (double) (into->count + from->count);
+    double delta = from->mean - into->mean;
+
+    into->mean += delta * (double) from->count / count;
+    into->m2 += from->m2 + delta * delta * (double) into->count * (double) from->count / count;
+    into->count += from->count;
+
+}
+
+
+/**
+ * The variance of the numbers so far
+ * @param w The running totals
+ * @return The sample variance, 0 with fewer than two numbers
+ */
+double welford_variance(const welford * w) {
+
+    return w->count > 1 ? w->m2 / (double) (w->count - 1) : 0;
+
+}
+
+
+/**
+ * Which bucket of a sketch a value goes in
+ * Small values have a bucket each, the rest have SKETCH_EXACT buckets to each power of two
+ * @param value The value, not negative
+ * @return The bucket
+ */
+static int sketch_bucket(const int value) {
+
+    if (value < SKETCH_EXACT) return value < 0 ? 0 : value;
+
+    int octave = 0;
+    while (value >> (octave + 1) >= SKETCH_EXACT) octave++;
+
+    return SKETCH_EXACT * (octave + 1) + (value >> octave) - SKETCH_EXACT;
+
+}
+
+
+/**
+ * The value in the middle of a bucket of a sketch
+ * @param bucket The bucket
+ * @return Its middle
+ */
+static double sketch_value(const int bucket) {
+
+    if (bucket < SKETCH_EXACT) return bucket;
+
+    int octave = bucket / SKETCH_EXACT - 1;
+    double low = (double) ((bucket % SKETCH_EXACT + SKETCH_EXACT) << octave);
+
+    return low + ((double) (1 << octave) - 1) / 2;
+
+}
+
+
+/**
+ * Count a value in a sketch
+ * @param sketch The sketch
+ * @param value The value, not negative
+ */
+void sketch_add(quantile_sketch * sketch, const int value) {
+
+    sketch->buckets[sketch_bucket(value)]++;
+
+}
+
+
+/**
+ * Add the values of one sketch to another, as if they had all been added to it
+ * @param into The sketch to add to
+ * @param from The sketch to add, left alone
+ */
+void sketch_merge(quantile_sketch * into, const quantile_sketch * from) {
+
+    for (int b = 0; b < SKETCH_BUCKETS; b++) into->buckets[b] += from->buckets[b];
+
+}
+
+
+/**
+ * Roughly a quantile of the values in a sketch
+ * Values under SKETCH_EXACT are exact, larger ones are within a few percent
+ * @param sketch The sketch
+ * @param q Which quantile, 0.5 is the median
+ * @return The quantile, 0 if the sketch is empty
+ */
+double sketch_quantile(const quantile_sketch * sketch, const double q) {
+
+    uint64_t total = 0;
+    for (int b = 0; b < SKETCH_BUCKETS; b++) total += sketch->buckets[b];
+    if (total == 0) return 0;
+
+    // The rank of the value wanted, counting from 0
+    uint64_t rank = (uint64_t) (q * (double) (total - 1) + 0.5);
+    uint64_t seen = 0;
+
+    for (int b = 0; b < SKETCH_BUCKETS; b++) {
+        seen += sketch->buckets[b];
+        if (seen > rank) return sketch_value(b);
+    }
+
+    return sketch_value(SKETCH_BUCKETS - 1);
+
+}
+
+
+/**
+ * Count each species in a simulation
+ * @param sim The simulation
+ * @param counts Frogs, slugs and lettuce
+ */
+void ensemble_species(simulation * sim, int counts[ENSEMBLE_SPECIES]) {
+
+    garden_walk walk;
+
+    for (int k = 0; k < ENSEMBLE_SPECIES; k++) counts[k] = 0;
+
+    sim_walk_start(sim, &walk);
+    while (sim_walk_next(sim, &walk)) {
+        INHABITANT_TYPE type = sim_get(sim, walk.pos).inhabitant_type;
+        if (type != EMPTY) counts[type]++;
+    }
+    sim_walk_end(&walk);
+
+}
+
+
+/**
+ * Add the species counts of one member of an ensemble to a round
+ * @param point The round
+ * @param counts Frogs, slugs and lettuce
+ */
+void ensemble_point_add(ensemble_point * point, const int counts[ENSEMBLE_SPECIES]) {
+
+    for (int k = 0; k < ENSEMBLE_SPECIES; k++) {
+        welford_add(&point->moments[k], counts[k]);
+        sketch_add(&point->sketch[k], counts[k]);
+    }
+
+}
+
+
+/**
+ * Add everything one worker knows about a round to another's
+ * @param into The round to add to
+ * @param from The round to add, left alone
+ */
+void ensemble_point_merge(ensemble_point * into, const ensemble_point * from) {
+
+    for (int k = 0; k < ENSEMBLE_SPECIES; k++) {
+        welford_merge(&into->moments[k], &from->moments[k]);
+        sketch_merge(&into->sketch[k], &from->sketch[k]);
+    }
+
+}
+
+
+/**
+ * How many rounds go into each point of an ensemble, so a run has no more than ENSEMBLE_POINTS
+ * The last round of each point stands for all of them
+ * @param rounds How many rounds the ensemble runs for
+ * @return The rounds in each point, at least 1
+ */
+int ensemble_every(const int rounds) {
+
+    return rounds > ENSEMBLE_POINTS ? (rounds + ENSEMBLE_POINTS - 1) / ENSEMBLE_POINTS : 1;
+
+}
+
+
+/**
+ * Write the column names of an ensemble time series
+ * @param out Where to write it
+ */
+void ensemble_header(FILE * out) {
+
+    fprintf(out, "round,species,members,mean,variance,p05,p50,p95\n");
+
+}
+
+
+/**
+ * Write a round of an ensemble time series, a line for each species
+ * @param out Where to write it
+ * @param point The round
+ * @param round Its round number
+ */
+void ensemble_write(FILE * out, const ensemble_point * point, const int round) {
+
+    const char * names[ENSEMBLE_SPECIES] = {"frog", "slug", "lettuce"};
+
+    for (int k = 0; k < ENSEMBLE_SPECIES; k++) {
+        const welford * w = &point->moments[k];
+        const quantile_sketch * s = &point->sketch[k];
+        fprintf(out, "%d,%s,%lld,%.4f,%.4f,%g,%g,%g\n", round, names[k], (long long) w->count, w->mean,
+                welford_variance(w), sketch_quantile(s, 0.05), sketch_quantile(s, 0.5), sketch_quantile(s, 0.95));
+    }
+
+}
@@ -0,0 +1,76 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_ENSEMBLE_H
+#define GARDEN_PARADISE_ENSEMBLE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Counts below this are kept exactly, larger ones in this many buckets per power of two
+#define SKETCH_EXACT 16
+// Enough for every int
+#define SKETCH_BUCKETS (SKETCH_EXACT + 27 * SKETCH_EXACT)
+
+// The most rounds an ensemble keeps statistics for, longer runs keep every few rounds instead
+#define ENSEMBLE_POINTS 256
+
+// Frogs, slugs and lettuce
+#define ENSEMBLE_SPECIES 3
+
+
+// Running mean and variance of a stream of numbers, see welford_add
+typedef struct {
+
+    int64_t count;
+    double mean;
+    // Sum of squared differences from the mean
+    double m2;
+
+} welford;
+
+// Counts of values in buckets a few percent wide, any two can be added together
+typedef struct {
+
+    uint32_t buckets[SKETCH_BUCKETS];
+
+} quantile_sketch;
+
+// Everything an ensemble knows about one of the rounds it keeps
+typedef struct {
+
+    welford moments[ENSEMBLE_SPECIES];
+    quantile_sketch sketch[ENSEMBLE_SPECIES];
+
+} ensemble_point;
+
+
+// Welford functions
+void welford_add(welford * w, double value);
+void welford_merge(welford * into, const welford * from);
+double welford_variance(const welford * w);
+
+// Sketch functions
+void sketch_add(quantile_sketch * sketch, int value);
+void sketch_merge(quantile_sketch * into, const quantile_sketch * from);
+double sketch_quantile(const quantile_sketch * sketch, double q);
+
+// Ensemble functions
+void ensemble_species(simulation * sim, int counts[ENSEMBLE_SPECIES]);
+void ensemble_point_add(ensemble_point * point, const int counts[ENSEMBLE_SPECIES]);
+void ensemble_point_merge(ensemble_point * into, const ensemble_point * from);
+int ensemble_every(int rounds);
+void ensemble_header(FILE * out);
+void ensemble_write(FILE * out, const ensemble_point * point, int round);
+
+
+#endif //GARDEN_PARADISE_ENSEMBLE_H
@@ -11,59 +11,262 @@
  * @param sim The simulation
  */
 void garden_round(simulation * sim) {
-    int t[2];
+    garden_walk walk;
+    int * t = walk.pos;
 
-    for (int x = 0; x < sim->x; x++) {
-        for (int y = 0; y < sim->y; y++) {
-            t[0] = x; t[1] = y;
+    // Split over several threads if the config asks for it and the garden allows it
+    if (engine_round(sim)) goto settle;
 
-            if (sim_get(sim, t) != NULL) {
+    sim_walk_start(sim, &walk);
+
+    while (sim_walk_next(sim, &walk)) {
 #ifdef DEBUG
-                printf("\nAction %d %d:", x,y);
-                if (sim->garden[x][y]->inhabitant_type == FROG) {
-                    printf("\n%d rounds old", sim->garden[x][y]->age);
-                }
+        printf("\nAction %d %d:", t[0], t[1]);
+        if (sim_get(sim, t).inhabitant_type == FROG) {
+            printf("\n%d rounds old", sim_get(sim, t).age);
+        }
 #endif
-                inhabitant_action(sim, t);
+        inhabitant_action(sim, t);
 #ifdef DEBUG
-                if (sim->garden[x][y] != NULL)
-                if (sim->garden[x][y]->inhabitant_type == FROG) {
-                    printf("\n%d rounds old post action\n", sim->garden[x][y]->age);
-                };
+        if (sim_get(sim, t).inhabitant_type == FROG) {
+            printf("\n%d rounds old post action\n", sim_get(sim, t).age);
+        };
 #endif
-
-            }
-        }
     }
 
+    sim_walk_end(&walk);
+
+settle:
+    garden_round_end(sim);
+
+}
+
+
+/**
+ * Finish a round once every inhabitant has had its turn
+ * Everything is settled and the round counted, and the series, heatmap and cluster log
+ * see it, however the turns were taken
+ * @param sim The simulation
+ */
+void garden_round_end(simulation * sim) {
+
+    if (sim->series != NULL) series_record(sim);
     reset_actions(sim);
 
     sim->round++;
 
+    if (sim->heatmap != NULL) heatmap_sample(sim);
+    if (sim->clusters != NULL) clusters_sample(sim);
+
+    // Keep the round with a file-backed garden, in case it is carried on later
+    if (sim->file != NULL) sim->file->header->round = sim->round;
+
 }
 
 
 /**
- * Set the 'actioned_this_round' value of every inhabitant struct in a simulation to false
+ * Set the 'actioned_this_round' value of every inhabitant in a simulation to false
+ * Everything that had its turn is aged at the same time, in one pass over the garden,
+ * and anything that has outlived its lifespan dies before the next round
+ * Sparse gardens also free any chunks that were emptied during the round
  * @param sim The simulation
  */
 void reset_actions(simulation * sim) {
-    int t[2];
 
     // Reset the actions for next round
-    for (int x = 0; x < sim->x; x++) {
-        for (int y = 0; y < sim->y; y++) {
+    sim_settle(sim);
 
-            t[0] = x; t[1] = y;
+    sim_trim(sim);
+}
 
-            if (sim_get(sim, t) != NULL) {
-#ifdef DEBUG
-                printf("\nDe actioned  %d %d", x,y);
-#endif
-                sim_get(sim, t)->actioned_this_round = false;
+
+/**
+ * Age every lettuce in a simulation by a number of rounds
+ * Lettuce age isn't part of the state hash, so it has to be caught up after skipping rounds
+ * @param sim The simulation
+ * @param rounds The number of rounds skipped
+ */
+static void age_lettuce(simulation * sim, const int rounds) {
+    garden_walk walk;
+    inhabitant i;
+
+    sim_walk_start(sim, &walk);
+    while (sim_walk_next(sim, &walk)) {
+
+        i = sim_get(sim, walk.pos);
+
+        if (i.inhabitant_type == LETTUCE) {
+            i.age += rounds;
+            i.hunger += rounds;
+            sim_set(sim, walk.pos, i);
+        }
+    }
+    sim_walk_end(&walk);
+}
+
+
+/**
+ * Run a simulation until it reaches a given round
+ * Brent's algorithm is run on the state hash as it goes, so once the garden settles
+ * into a cycle the remaining whole cycles are skipped instead of simulated
+ * With PROCESSES the rounds are split between processes instead, and run all the way
+ * A garden with a series, heatmap or cluster log is run every round of the way, so every
+ * round is seen
+ * @param sim The simulation
+ * @param target_round The round to stop at
+ * @return The length of the cycle that was found, 0 if there wasn't one
+ */
+int garden_jump(simulation * sim, const int target_round) {
+
+    if (sim->series != NULL || sim->heatmap != NULL || sim->clusters != NULL) {
+        while (sim->round < target_round) garden_round(sim);
+        return 0;
+    }
+
+    if (domain_run(sim, target_round - sim->round, domain_socket_pair)) return 0;
+
+    uint64_t saved = sim_state_hash(sim);
+    int power = 1;
+    int length = 0;
+
+    while (sim->round < target_round) {
+
+        garden_round(sim);
+        length++;
+
+        if (sim_state_hash(sim) == saved) {
+            // The state 'length' rounds ago has come round again, so every
+            // 'length' rounds from now will look exactly like this one
+            int remainder = (target_round - sim->round) % length;
+            age_lettuce(sim, target_round - remainder - sim->round);
+            sim->round = target_round - remainder;
+
+            while (sim->round < target_round)
+                garden_round(sim);
+
+            return length;
+        }
+
+        // Move the saved state forward, looking for longer cycles each time
+        if (length == power) {
+            saved = sim_state_hash(sim);
+            power *= 2;
+            length = 0;
+        }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Run several simulations until they reach a given round, a round at a time, and keep the
+ * spread of each species over them as they go
+ * Every garden is run one round before any runs the next, so a row of the series can be
+ * written as soon as the round it is for has finished. Gardens that can share a batch are
+ * still run BATCH_LANES at a time, and any that can't are run one by one
+ * @param sims The simulations
+ * @param count How many
+ * @param target_round The round to stop at
+ * @param series Where to write the time series
+ * @return If there was room to keep the batches and statistics
+ */
+static bool garden_jump_ensemble(simulation ** sims, const int count, const int target_round, FILE * series) {
+
+    int groups = (count + BATCH_LANES - 1) / BATCH_LANES;
+    garden_batch ** batches = calloc((size_t) groups, sizeof(garden_batch *));
+    ensemble_point * point = malloc(sizeof(ensemble_point));
+    if (batches == NULL || point == NULL) {
+        free(batches);
+        free(point);
+        return false;
+    }
+
+    for (int g = 0; g < groups; g++) {
+        int lanes = count - g * BATCH_LANES < BATCH_LANES ? count - g * BATCH_LANES : BATCH_LANES;
+        batches[g] = lanes > 1 ? batch_create(sims + g * BATCH_LANES, lanes) : NULL;
+    }
+
+    int start = sims[0]->round;
+    int every = ensemble_every(target_round - start);
+
+    ensemble_header(series);
+    memset(point, 0, sizeof(ensemble_point));
+
+    for (int round = start + 1; round <= target_round; round++) {
+
+        for (int g = 0; g < groups; g++) {
+            int lanes = count - g * BATCH_LANES < BATCH_LANES ? count - g * BATCH_LANES : BATCH_LANES;
+            int counts[BATCH_LANES][ENSEMBLE_SPECIES];
+
+            if (batches[g] != NULL) {
+                batch_round(batches[g]);
+                batch_species(batches[g], counts);
+            } else {
+                for (int l = 0; l < lanes; l++) {
+                    garden_round(sims[g * BATCH_LANES + l]);
+                    ensemble_species(sims[g * BATCH_LANES + l], counts[l]);
+                }
             }
+
+            // The last round of each point stands for all of them
+            if ((round - start) % every == 0 || round == target_round)
+                for (int l = 0; l < lanes; l++) ensemble_point_add(point, counts[l]);
         }
+
+        if ((round - start) % every == 0 || round == target_round) {
+            ensemble_write(series, point, round);
+            fflush(series);
+            memset(point, 0, sizeof(ensemble_point));
+        }
+    }
+
+    for (int g = 0; g < groups; g++) {
+        if (batches[g] == NULL) continue;
+        batch_unpack(batches[g], sims + g * BATCH_LANES);
+        batch_free(batches[g]);
     }
+
+    free(batches);
+    free(point);
+
+    return true;
+
+}
+
+
+/**
+ * Run several simulations until they reach a given round
+ * Gardens that can share a batch are run BATCH_LANES at a time, side by side, and any that
+ * can't are run one by one with garden_jump. Batched gardens don't look for cycles
+ * With a series every garden is run every round instead, and the spread of each species over
+ * them is written out as the rounds finish, see garden_jump_ensemble
+ * @param sims The simulations
+ * @param count How many
+ * @param target_round The round to stop at
+ * @param series Where to write the time series, NULL for none
+ */
+void garden_jump_all(simulation ** sims, const int count, const int target_round, FILE * series) {
+
+    if (series != NULL && count > 0 && garden_jump_ensemble(sims, count, target_round, series)) return;
+
+    for (int n = 0; n < count; n += BATCH_LANES) {
+
+        int lanes = count - n < BATCH_LANES ? count - n : BATCH_LANES;
+        garden_batch * batch = lanes > 1 ? batch_create(sims + n, lanes) : NULL;
+
+        if (batch == NULL) {
+            for (int l = n; l < n + lanes; l++) garden_jump(sims[l], target_round);
+            continue;
+        }
+
+        while (batch->round < target_round) batch_round(batch);
+
+        batch_unpack(batch, sims + n);
+        batch_free(batch);
+    }
+
 }
 
 
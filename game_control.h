@@ -7,7 +7,13 @@
 
 
 
+#include "batch.h"
+#include "clusters.h"
+#include "domain.h"
+#include "engine.h"
+#include "heatmap.h"
 #include "inhabitant.h"
+#include "series.h"
 #include "simulation.h"
 #include "utils.h"
 
@@ -17,7 +23,10 @@
 
 
 void garden_round(simulation * sim);
+void garden_round_end(simulation * sim);
 void reset_actions(simulation * sim);
+int garden_jump(simulation * sim, int target_round);
+void garden_jump_all(simulation ** sims, int count, int target_round, FILE * series);
 
 
 void terminal_header(void);
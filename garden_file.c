@@ -0,0 +1,144 @@
+//
+// Created on 19/10/2026.
+//
+
+// mmap and madvise are not part of standard C
+#define _DEFAULT_SOURCE
+
+#include "garden_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#define GARDEN_FILE_MAGIC "GARDEN01"
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * Open a file-backed garden, creating the file if it isn't already a garden of this size
+ * The operating system pages the cells in and out, so the garden can be larger than memory,
+ * and whatever is in it when the program ends is still there next time
+ * @param filename The file
+ * @param x Dimension of the garden
+ * @param y Dimension of the garden
+ * @return The garden file, NULL if it couldn't be opened
+ */
+garden_file * garden_file_open(const char * filename, const int x, const int y) {
+
+    size_t size = sizeof(garden_file_header) + (size_t) x * (size_t) y * sizeof(cell);
+
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    // Carry on with the garden in the file if it is the right size and from this build
+    struct stat st;
+    garden_file_header existing;
+    fstat(fd, &st);
+    bool resumed = (size_t) st.st_size == size &&
+                   pread(fd, &existing, sizeof(existing), 0) == (ssize_t) sizeof(existing) &&
+                   !memcmp(existing.magic, GARDEN_FILE_MAGIC, 8) &&
+                   existing.x == x && existing.y == y &&
+                   existing.cell_size == (int) sizeof(cell);
+
+    // Anything else in the file is thrown away. The file grows back as zeros, so every
+    // cell is EMPTY without writing to it
+    if (!resumed && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t) size) != 0)) {
+        close(fd);
+        return NULL;
+    }
+
+    void * map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    garden_file * out = malloc(sizeof(garden_file));
+    out->fd = fd;
+    out->size = size;
+    out->header = map;
+    out->cells = (cell *) (out->header + 1);
+    out->resumed = resumed;
+
+    // Rounds walk the garden row by row, so let the kernel read ahead and drop behind
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    if (!resumed) {
+        memcpy(out->header->magic, GARDEN_FILE_MAGIC, 8);
+        out->header->x = x;
+        out->header->y = y;
+        out->header->round = 0;
+        out->header->cell_size = (int) sizeof(cell);
+    }
+
+    return out;
+
+}
+
+
+/**
+ * Ask for rows of a file-backed garden to be read in before they are needed
+ * @param file The garden file
+ * @param row The first row
+ * @param rows How many rows
+ */
+void garden_file_prefetch(garden_file * file, int row, int rows) {
+
+    if (row >= file->header->x) return;
+    if (row + rows > file->header->x) rows = file->header->x - row;
+
+    // madvise needs a page aligned start
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = (size_t) ((char *) (file->cells + (size_t) row * file->header->y) - (char *) file->header);
+    size_t end = start + (size_t) rows * file->header->y * sizeof(cell);
+    start -= start % page;
+
+    madvise((char *) file->header + start, end - start, MADV_WILLNEED);
+
+}
+
+
+/**
+ * Write a file-backed garden back to disk and close it
+ * @param file The garden file
+ * @param round The round the garden has reached, so it can be carried on from
+ */
+void garden_file_close(garden_file * file, const int round) {
+
+    if (file == NULL) return;
+
+    file->header->round = round;
+
+    msync(file->header, file->size, MS_SYNC);
+    munmap(file->header, file->size);
+    close(file->fd);
+
+    free(file);
+
+}
+
+#else
+
+// No mmap, so no file-backed gardens
+garden_file * garden_file_open(const char * filename, const int x, const int y) {
+    (void) filename; (void) x; (void) y;
+    printf("File-backed gardens aren't supported on this platform\n");
+    return NULL;
+}
+
+void garden_file_prefetch(garden_file * file, int row, int rows) {
+    (void) file; (void) row; (void) rows;
+}
+
+void garden_file_close(garden_file * file, const int round) {
+    (void) file; (void) round;
+}
+
+#endif
@@ -0,0 +1,59 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_GARDEN_FILE_H
+#define GARDEN_PARADISE_GARDEN_FILE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Rows read ahead of a walk through a file-backed garden
+#define GARDEN_FILE_READAHEAD 64
+
+
+// Start of every garden file, the cells follow straight after
+typedef struct {
+
+    char magic[8];
+
+    int x;
+    int y;
+    int round;
+
+    // Files written by a build with a different cell layout are not reused
+    int cell_size;
+
+} garden_file_header;
+
+
+// A garden kept in a memory-mapped file
+struct GARDEN_FILE {
+
+    int fd;
+    size_t size;
+
+    garden_file_header * header;
+    cell * cells;
+
+    // Whether the file already held a garden when it was opened
+    bool resumed;
+
+};
+
+
+// Garden_file functions
+garden_file * garden_file_open(const char * filename, int x, int y);
+void garden_file_prefetch(garden_file * file, int row, int rows);
+void garden_file_close(garden_file * file, int round);
+
+
+#endif //GARDEN_PARADISE_GARDEN_FILE_H
@@ -6,9 +6,12 @@
 #define GARDEN_PARADISE_GLOBAL_STRUCTS_H
 
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "global_enums.h"
+#include "utils.h"
 
 
 
@@ -28,6 +31,17 @@ typedef struct {
     double FROG_REPRODUCE_PROB;
     int FROG_VISION_DISTANCE;
 
+    // Optional, see read_optional_config_line
+    int GARDEN_ROWS;
+    int GARDEN_COLUMNS;
+    bool WRAP_AROUND;
+    bool SPARSE_GARDEN;
+    bool TILED_GARDEN;
+    int THREADS;
+    bool ASYNC_ROUNDS;
+    int PROCESSES;
+    char GARDEN_FILE[256];
+
 } CONFIG;
 
 
@@ -42,27 +56,187 @@ typedef struct {
     int hunger;
 
     bool actioned_this_round;
+    // Born this round, so it doesn't age until the next
+    bool newborn;
 
 } inhabitant;
 
 
+// Inhabitants are stored in the garden packed into a single word
+// bits 0-1   inhabitant_type + 1, so an EMPTY cell is 0
+// bits 2-5   next_move
+// bit  6     actioned_this_round, set once an inhabitant has had its turn
+// bit  7     newborn
+// bit  8     wall, only in the border around a dense garden, with no inhabitant_type
+//            busy when there is an inhabitant_type, claimed by a worker in an async round,
+//            see CELL_IS_WALL and CELL_IS_BUSY
+// bits 9-20  age, stops at CELL_AGE_MAX
+// bits 21-31 hunger, stops at CELL_HUNGER_MAX
+typedef uint32_t cell;
+
+#define CELL_EMPTY 0u
+#define CELL_TYPE_MASK 0x3u
+#define CELL_MOVE_SHIFT 2
+#define CELL_MOVE_MASK 0xFu
+#define CELL_ACTIONED (1u << 6)
+#define CELL_NEWBORN (1u << 7)
+#define CELL_WALL (1u << 8)
+#define CELL_BUSY (1u << 8)
+#define CELL_AGE_SHIFT 9
+#define CELL_AGE_MAX 0xFFF
+#define CELL_HUNGER_SHIFT 21
+#define CELL_HUNGER_MAX 0x7FF
+
+// Type of the inhabitant in a cell, without unpacking the rest
+#define CELL_TYPE(c) ((INHABITANT_TYPE) ((int) ((c) & CELL_TYPE_MASK) - 1))
+
+// Walls and busy cells share bit 8 and are told apart by the type bits, so always test them
+// with these. A wall has no inhabitant to claim, and a claim is only ever made on an inhabitant
+#define CELL_IS_WALL(c) (((c) & (CELL_TYPE_MASK | CELL_WALL)) == CELL_WALL)
+#define CELL_IS_BUSY(c) (((c) & CELL_TYPE_MASK) && ((c) & CELL_BUSY))
+
+
+
+
+
+// The last action in a simulation, as it was given to update_action_message
+typedef struct {
+
+    bool set;
+    ACTION action;
+
+    inhabitant actor;
+    int at[2];
+
+    // The inhabitant acted on and where, if there was one
+    bool has_recipient;
+    inhabitant recipient;
+    bool has_target;
+    int target[2];
+
+} action_record;
+
 
 
+// Defined in chunk_map.h
+typedef struct CHUNK_MAP chunk_map;
+// Defined in garden_file.h
+typedef struct GARDEN_FILE garden_file;
+// Defined in engine.h
+typedef struct ROUND_ENGINE round_engine;
+// Defined in series.h
+typedef struct SERIES_WRITER series_writer;
+// Defined in heatmap.h
+typedef struct HEATMAP heatmap;
+// Defined in clusters.h
+typedef struct CLUSTER_LOG cluster_log;
+
 
 typedef struct {
 
     int x;
     int y;
-    inhabitant *** garden;
+
+    // Row-major cells, NULL for sparse gardens which use chunks instead
+    // Points into the file for file-backed gardens
+    cell * garden;
+    // In-memory dense gardens have a border of pad walls on every side, so
+    // rows are stride cells apart and garden points at (0, 0) inside the border
+    // Tiled gardens have a ring of wall tiles instead, and stride counts tiles
+    bool tiled;
+    int pad;
+    int stride;
+
+    // Dense gardens only, how many inhabitants are in each row, and for in-memory gardens
+    // a bit for every cell that isn't EMPTY, occupied_words words to a row
+    _Atomic int * row_population;
+    _Atomic uint64_t * occupied;
+    int occupied_words;
+    chunk_map * chunks;
+    garden_file * file;
+
+    // Wrap-around (torus) edges, set from the config by sim_set_config
+    bool wrap;
+    // x - 1 and y - 1 when both are powers of two, so wrapping is just a mask
+    int x_mask;
+    int y_mask;
 
     int round;
 
+    random_generator rng;
+
+    // Gaps until the next lettuce grows, slug reproduces or frog reproduces
+    skip_counter lettuce_grow;
+    skip_counter slug_reproduce;
+    skip_counter frog_reproduce;
+
+    // Zobrist hash of every cell, kept up to date by sim_set
+    uint64_t hash;
+
     CONFIG * config;
 
-    char ** last_action_message;
+    // Set on the copies of the simulation that run an async round, see sim_take
+    bool async;
+
+    // Only turned into words when it is printed, see print_last_action_message
+    action_record last_action;
+
+    // Workers for tile-parallel rounds, made by the first round that uses them
+    round_engine * engine;
+
+    // Where every round's counts are written, NULL if they aren't, see series_record
+    series_writer * series;
+    // Since the series last wrote them
+    int births;
+    int meals;
+
+    // Where everything has been over the rounds, NULL if it isn't kept, see heatmap_sample
+    heatmap * heatmap;
+
+    // Where the clusters are written every few rounds, NULL if they aren't, see clusters_sample
+    cluster_log * clusters;
 
 } simulation;
 
 
 
+// Everything an inhabitant needs to know about what is around it, found in one pass by sim_scan
+// Each position is picked uniformly at random from all of those that were counted
+typedef struct {
+
+    // Food within the radius, and the cell it was in when it was seen
+    int food_count;
+    int food[2];
+    cell food_cell;
+
+    // Mature inhabitants of the same type within the radius
+    int mate_count;
+
+    // Empty cells next door, for a child to go in
+    int space_count;
+    int space[2];
+
+    // Empty cells within the radius, for moving to, only looked for if asked
+    int roam_count;
+    int roam[2];
+
+} neighbourhood;
+
+
+// What is in a garden as its round settles, found in one pass by sim_census
+// Young and mature are the split pretty_print shows as s/S and f/F
+typedef struct {
+
+    int lettuce;
+    int slugs;
+    int mature_slugs;
+    int frogs;
+    int mature_frogs;
+    // Those that die as the round settles, not counted in the others
+    int deaths;
+
+} garden_census;
+
+
+
 #endif //GARDEN_PARADISE_GLOBAL_STRUCTS_H
@@ -0,0 +1,161 @@
+//
+// Created on 19/10/2026.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "heatmap.h"
+#include "simulation.h"
+
+
+// How often each part of a garden has had each species in it
+// Each pixel is a block of block x block cells, so big gardens make small images
+struct HEATMAP {
+
+    int width;
+    int height;
+    int block;
+
+    // Sample every this many rounds
+    int every;
+    int samples;
+
+    // counts[species][pixel], one array to a species, pixel is row * width + column
+    uint32_t * counts[HEATMAP_SPECIES];
+
+};
+
+
+/**
+ * Start keeping a heatmap of a simulation, set it as sim->heatmap
+ * @param sim The simulation
+ * @param every Sample every this many rounds
+ * @param block How many cells wide and tall each pixel is
+ * @return The heatmap, NULL if there isn't the memory for it, in which case try a bigger block
+ */
+heatmap * heatmap_create(simulation * sim, const int every, const int block) {
+
+    heatmap * out = malloc(sizeof(heatmap));
+    if (out == NULL) return NULL;
+
+    out->block = block > 1 ? block : 1;
+    out->every = every > 1 ? every : 1;
+    out->samples = 0;
+    out->height = (sim->x + out->block - 1) / out->block;
+    out->width = (sim->y + out->block - 1) / out->block;
+
+    bool ok = true;
+    for (int k = 0; k < HEATMAP_SPECIES; k++) {
+        out->counts[k] = calloc((size_t) out->width * (size_t) out->height, sizeof(uint32_t));
+        if (out->counts[k] == NULL) ok = false;
+    }
+
+    if (!ok) {
+        heatmap_free(out);
+        return NULL;
+    }
+
+    return out;
+
+}
+
+
+/**
+ * Add where everything is now to the heatmap of a simulation, if this round is sampled
+ * Only the cells with something in them are visited, so a sample costs about as much as
+ * the garden has inhabitants
+ * @param sim The simulation, after its round has settled
+ */
+void heatmap_sample(simulation * sim) {
+
+    heatmap * map = sim->heatmap;
+    if (sim->round % map->every) return;
+
+    garden_walk walk;
+
+    sim_walk_start(sim, &walk);
+    while (sim_walk_next(sim, &walk)) {
+        INHABITANT_TYPE type = sim_get(sim, walk.pos).inhabitant_type;
+        if (type == EMPTY) continue;
+
+        size_t pixel = (size_t) (walk.pos[0] / map->block) * (size_t) map->width + (size_t) (walk.pos[1] / map->block);
+        map->counts[type][pixel]++;
+    }
+    sim_walk_end(&walk);
+
+    map->samples++;
+
+}
+
+
+/**
+ * Write each species' map as a 16-bit greyscale PGM image, PREFIX_frog.pgm and so on
+ * Each is scaled so the busiest pixel is white. How many samples there were and the
+ * count the busiest pixel stands for are in a comment, so the counts can be got back
+ * @param map The heatmap
+ * @param prefix The start of each file name
+ * @return false if a file couldn't be written
+ */
+bool heatmap_write(const heatmap * map, const char * prefix) {
+
+    const char * names[HEATMAP_SPECIES] = {"frog", "slug", "lettuce"};
+    size_t pixels = (size_t) map->width * (size_t) map->height;
+    bool ok = true;
+
+    for (int k = 0; k < HEATMAP_SPECIES; k++) {
+
+        char filename[512];
+        snprintf(filename, sizeof(filename), "%s_%s.pgm", prefix, names[k]);
+
+        FILE * file = fopen(filename, "wb");
+        if (file == NULL) {
+            ok = false;
+            continue;
+        }
+
+        uint32_t most = 0;
+        for (size_t p = 0; p < pixels; p++)
+            if (map->counts[k][p] > most) most = map->counts[k][p];
+
+        fprintf(file, "P5\n# %d samples of %dx%d cells, white is %u\n%d %d\n65535\n", map->samples, map->block,
+                map->block, most, map->width, map->height);
+
+        // Most significant byte first, as PGM wants
+        unsigned char * row = malloc((size_t) map->width * 2);
+        if (row == NULL) {
+            fclose(file);
+            ok = false;
+            continue;
+        }
+        for (int x = 0; x < map->height; x++) {
+            for (int y = 0; y < map->width; y++) {
+                uint32_t count = map->counts[k][(size_t) x * map->width + y];
+                uint32_t level = most ? (uint32_t) ((uint64_t) count * 65535 / most) : 0;
+                row[2 * y] = (unsigned char) (level >> 8);
+                row[2 * y + 1] = (unsigned char) level;
+            }
+            fwrite(row, 2, (size_t) map->width, file);
+        }
+        free(row);
+
+        if (fclose(file)) ok = false;
+    }
+
+    return ok;
+
+}
+
+
+/**
+ * Free a heatmap
+ * @param map The heatmap, may be NULL
+ */
+void heatmap_free(heatmap * map) {
+
+    if (map == NULL) return;
+
+    for (int k = 0; k < HEATMAP_SPECIES; k++) free(map->counts[k]);
+    free(map);
+
+}
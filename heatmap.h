@@ -0,0 +1,28 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_HEATMAP_H
+#define GARDEN_PARADISE_HEATMAP_H
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Frogs, slugs and lettuce each have a map
+#define HEATMAP_SPECIES 3
+
+
+// Heatmap functions
+heatmap * heatmap_create(simulation * sim, int every, int block);
+void heatmap_sample(simulation * sim);
+bool heatmap_write(const heatmap * map, const char * prefix);
+void heatmap_free(heatmap * map);
+
+
+#endif //GARDEN_PARADISE_HEATMAP_H
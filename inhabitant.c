@@ -7,124 +7,119 @@
 
 
 /**
- * Create an inhabitant struct and return a pointer to it
- * @param i_type The type of the inhabitant
+ * Create an inhabitant struct
+ * Inhabitants are stored by value in the garden, so there is nothing to free
+ * @param i_type The type of the inhabitant, EMPTY for an empty cell
  * @param initial_age Its initial age
  * @param lastMove It's last move, only relevant for SLUG
- * @return The pointer
+ * @return The inhabitant
  */
-inhabitant * create_inhabitant(INHABITANT_TYPE i_type, int initial_age, DIRECTION lastMove) {
+inhabitant create_inhabitant(INHABITANT_TYPE i_type, int initial_age, DIRECTION lastMove) {
 
-    if (i_type == EMPTY) return NULL;
-
-    inhabitant * out = malloc(sizeof(inhabitant));
-    out->inhabitant_type = i_type;
-    out->next_move = lastMove;
-    out->age = initial_age;
-    out->hunger = 0;
-    out->actioned_this_round = false;
+    inhabitant out;
+    out.inhabitant_type = i_type;
+    out.next_move = lastMove;
+    out.age = initial_age;
+    out.hunger = 0;
+    out.actioned_this_round = false;
+    out.newborn = false;
 
     return out;
 
 }
 
 
-/**
- * Free an inhabitant
- * @param i The inhabitant
- */
-void free_inhabitant(inhabitant * i) {
-    free(i);
-}
-
-
 /**
  * Attempt to perform an action on an inhabitant
  * Order of potential actions:
- * - Die
  * - Eat
  * - Reproduce
  * - Move
  * - Do nothing
- * Then age is incremented
+ * Then it is marked as having had its turn, it ages with everything else in sim_settle
+ * Inhabitants don't check their own lifespan, sim_settle removes them once they outlive it
  * @param sim The simulation this is performed in
  * @param coord The coordinates of the inhabitant
  */
 void inhabitant_action(simulation * sim, const int coord[2]) {
 
-    inhabitant * i = sim_get(sim, coord);
+    // A copy, written back once the inhabitant has finished
+    inhabitant i = sim_get(sim, coord);
+
+    // Where the inhabitant is, eating and moving will change this
+    int pos[2] = {coord[0], coord[1]};
+
+    // What is around it, one scan is shared by everything it tries to do this turn.
+    // Nothing changes until one of them succeeds, and then it stops trying
+    neighbourhood around;
 
     // Skip if the inhabitant has already moved this round
-    if (i->actioned_this_round) {
+    if (i.actioned_this_round) {
         update_action_message(sim,
-                              i, coord, TIRED,
+                              &i, coord, TIRED,
                               NULL, NULL);
         return;
     }
 
 
 #ifdef DEBUG
-    printf("Position %d %d has age %d\n", coord[0], coord[1], i->age);
+    printf("Position %d %d has age %d\n", coord[0], coord[1], i.age);
 #endif
     // Just created, ignore this round
-    if (i->age >= 0) {
+    if (i.age >= 0) {
 
-        switch (i->inhabitant_type) {
+        switch (i.inhabitant_type) {
 
             case LETTUCE:
-                if (event_roll(sim->config->LETTUCE_GROW_PROB) && !i->actioned_this_round) {
-                    i->actioned_this_round = breed(sim, coord);
+                // Only worth looking around once it is going to grow
+                if (skip_roll(&sim->rng, &sim->lettuce_grow, sim->config->LETTUCE_GROW_PROB) && !i.actioned_this_round) {
+                    sim_scan(sim, pos, LETTUCE, 1, 0, false, &around);
+                    i.actioned_this_round = breed(sim, pos, &around);
                 }
                 break;
 
             case SLUG:
-                // Die
-                if (i->age > sim->config->SLUG_LIFESPAN) {
-                    die(sim, coord);
-                    return;
-                }
+                sim_scan(sim, pos, SLUG, 1, sim->config->SLUG_MATURE_AGE, false, &around);
 
                 // Eat
-                if (!i->actioned_this_round) {
-                    i->actioned_this_round = eat(sim, coord);
+                if (!i.actioned_this_round) {
+                    i.actioned_this_round = eat(sim, pos, &around);
                 }
 
                 // Reproduce
-                if (event_roll(sim->config->SLUG_REPRODUCE_PROB) && !i->actioned_this_round) {
-                    i->actioned_this_round = breed(sim, coord);
+                if (skip_roll(&sim->rng, &sim->slug_reproduce, sim->config->SLUG_REPRODUCE_PROB) && !i.actioned_this_round) {
+                    i.actioned_this_round = breed(sim, pos, &around);
                 }
 
                 // Move
-                if (!i->actioned_this_round) {
-                    i->actioned_this_round = move_s(sim, coord);
+                if (!i.actioned_this_round) {
+                    i.actioned_this_round = move_s(sim, pos);
                 }
 
                 break;
 
             case FROG:
 
-                // Die
-                if (i->age > sim->config->FROG_LIFESPAN) {
-                    die(sim, coord);
-                    return;
-                }
+                // Only hungry frogs move, so only they need somewhere to move to
+                sim_scan(sim, pos, FROG, sim->config->FROG_VISION_DISTANCE, sim->config->FROG_MATURE_AGE,
+                         i.hunger >= sim->config->FROG_HUNGRY, &around);
 
                 // Eat
-                if (!i->actioned_this_round) {
-                    i->actioned_this_round = eat(sim, coord);
+                if (!i.actioned_this_round) {
+                    i.actioned_this_round = eat(sim, pos, &around);
                 }
 
                 // Reproduce
-                if (event_roll(sim->config->FROG_REPRODUCE_PROB) && !i->actioned_this_round) {
-                    i->actioned_this_round = breed(sim, coord);
-                    if (i->actioned_this_round)
-                        i->hunger = 0;
+                if (skip_roll(&sim->rng, &sim->frog_reproduce, sim->config->FROG_REPRODUCE_PROB) && !i.actioned_this_round) {
+                    i.actioned_this_round = breed(sim, pos, &around);
+                    if (i.actioned_this_round)
+                        i.hunger = 0;
                 }
 
                 // Move
-                if (!i->actioned_this_round) {
-                    if (i->hunger >= sim->config->FROG_HUNGRY) {
-                        i->actioned_this_round = move_f(sim, coord);
+                if (!i.actioned_this_round) {
+                    if (i.hunger >= sim->config->FROG_HUNGRY) {
+                        i.actioned_this_round = move_f(sim, pos, &around);
                     }
                 }
 
@@ -136,78 +131,64 @@ void inhabitant_action(simulation * sim, const int coord[2]) {
 
         }
 
-        if (!i->actioned_this_round)
+        if (!i.actioned_this_round)
             update_action_message(sim,
-                                  sim_get(sim, coord), coord, NOTHING,
+                                  &i, coord, NOTHING,
                                   NULL, NULL);
 
     }
 
-    i->hunger++;
-    i->age++;
+    // Write back to wherever it ended up, moving may have changed its direction
+    inhabitant moved = sim_get(sim, pos);
+    moved.actioned_this_round = true;
+    moved.hunger = i.hunger;
+    sim_set(sim, pos, moved);
 }
 
 
 
 /**
- * Eat function for all inhabitant types, frees the inhabitant that is eaten
+ * Eat function for all inhabitant types, removes the inhabitant that is eaten
  * @param sim The simulation this happens in
- * @param hungry The coordinates of the hungry inhabitant
+ * @param hungry The coordinates of the hungry inhabitant, updated to where it moved to
+ * @param around What the hungry inhabitant can see, from sim_scan
  * @return If the move was completed
  */
-bool eat(simulation * sim, const int hungry[2]) {
+bool eat(simulation * sim, int hungry[2], const neighbourhood * around) {
 
     // Input sanitisation
     if (!in_bounds(sim, hungry)) return false;
     if (is_null(sim, hungry)) return false;
 
     // Check valid typing
-    INHABITANT_TYPE type = sim_get(sim, hungry)->inhabitant_type;
+    inhabitant eater = sim_get(sim, hungry);
+    INHABITANT_TYPE type = eater.inhabitant_type;
     if (type != SLUG && type != FROG) return false;
 
 
-    // Some setup
-    int size;
-    int target[2];
-
-    int vision_dist;
-    if (type == SLUG) vision_dist = 1;
-    if (type == FROG) vision_dist = sim->config->FROG_VISION_DISTANCE;
-
-
-    // Get all food
-    coord_ll * visible_food = find_all(sim, type + 1, hungry, vision_dist);
-
-
-    size = coord_ll_size(visible_food);
 #ifdef DEBUG
-    printf("%d is visible_food size\n", size);
+    printf("%d is visible_food size\n", around->food_count);
 #endif
 
     // If there is no food, don't eat any
-    if (size == 0) {
-        coord_ll_free(visible_food);
-        return false;
-    }
+    if (around->food_count == 0) return false;
 
+    // The scan has already picked some food at random
+    int target[2] = {around->food[0], around->food[1]};
 
-    // Pick random food from the list
-    coord_ll * chosen = coord_ll_get(visible_food, dice_roll(coord_ll_size(visible_food)));
-    target[0] = chosen->values[0];
-    target[1] = chosen->values[1];
-
-    // Free the linked list as it is no longer needed
-    coord_ll_free(visible_food);
+    // Moving overwrites the food, so don't need to remove that
+    // In an async round someone else may have got to it first
+    inhabitant food = sim_get(sim, target);
+    if (!sim_take(sim, target, around->food_cell, eater, true)) return false;
+    sim_clear(sim, hungry);
 
     update_action_message(sim,
-                          sim_get(sim, hungry), hungry, EAT,
-                          sim_get(sim, target), target);
-
+                          &eater, hungry, EAT,
+                          &food, target);
+    sim->meals++;
 
-    // Moving frees the old value, so don't need to update that
-    free_inhabitant(sim_get(sim, target));
-    sim_set(sim, target, sim_get(sim, hungry));
-    sim_set(sim, hungry, NULL);
+    hungry[0] = target[0];
+    hungry[1] = target[1];
 
     return true;
 
@@ -219,20 +200,19 @@ bool eat(simulation * sim, const int hungry[2]) {
  * If required, a check is performed for a valid parent
  * @param sim The simulation to perform the action in
  * @param parent The coordinate {x, y} of the parent
+ * @param around What the parent can see, from sim_scan
  * @return Success
  */
-bool breed(simulation * sim, const int parent[2]) {
+bool breed(simulation * sim, const int parent[2], const neighbourhood * around) {
 
     // Input sanitisation
     if (!in_bounds(sim, parent)) return false;
 
-    inhabitant * i = sim_get(sim, parent);
-    if (i == NULL) return false;
+    inhabitant i = sim_get(sim, parent);
+    if (i.inhabitant_type == EMPTY) return false;
 
     // Some setup
-    INHABITANT_TYPE type = i->inhabitant_type;
-    int size;
-    int target[2];
+    INHABITANT_TYPE type = i.inhabitant_type;
     bool found_mate = false;
 
     // Lettuce don't need a mate to breed
@@ -244,56 +224,31 @@ bool breed(simulation * sim, const int parent[2]) {
     if (!found_mate) {
 
         // Some setup for Slugs/Frogs
-        int vision_dist;
-        if (type == SLUG) vision_dist = 1;
-        if (type == FROG) vision_dist = sim->config->FROG_VISION_DISTANCE;
-
         int mature_age;
         if (type == SLUG) mature_age = sim->config->SLUG_MATURE_AGE;
         if (type == FROG) mature_age = sim->config->FROG_MATURE_AGE;
 
         // Haven't created anything that needs freeing at this point
-        if (i->age < mature_age) return false;
+        if (i.age < mature_age) return false;
 
 
 
-        // Find all visible of same type as parent
-        coord_ll * potential_mates = find_all(sim, type, parent, vision_dist);
-
-        // Check if they can breed
-        for (int j = 0; j < coord_ll_size(potential_mates); j++) {
-            if (sim_get(sim, coord_ll_get(potential_mates, j)->values)->age >= mature_age)
-                found_mate = true;
-        }
-
-        coord_ll_free(potential_mates);
+        // The scan counted the visible mates that are old enough
+        found_mate = around->mate_count > 0;
 
     }
     if (!found_mate) return false;
 
 
-    // Find all free spaces within 1
-    coord_ll * visible_spaces = find_all(sim, EMPTY, parent, 1);
-
-
-    size = coord_ll_size(visible_spaces);
 #ifdef DEBUG
-    printf("%d is visible_spaces size\n", size);
+    printf("%d is visible_spaces size\n", around->space_count);
 #endif
 
     // There is no space to create another lettuce
-    if (size == 0) {
-        coord_ll_free(visible_spaces);
-        return false;
-    }
-
+    if (around->space_count == 0) return false;
 
-    // Pick a space to move to
-    coord_ll * chosen = coord_ll_get(visible_spaces, dice_roll(size));
-    target[0] = chosen->values[0];
-    target[1] = chosen->values[1];
-
-    coord_ll_free(visible_spaces);
+    // The scan has already picked a free space next door at random
+    int target[2] = {around->space[0], around->space[1]};
 
 #ifdef DEBUG
     printf("Got here\n");
@@ -301,16 +256,19 @@ bool breed(simulation * sim, const int parent[2]) {
 #endif
 
     // Perform the move
-    free_inhabitant(sim_get(sim, target));
-    sim_set(sim, target, create_inhabitant(type, 0, STATIONARY));
+    inhabitant child = create_inhabitant(type, 0, STATIONARY);
 
     /// I have decided that an entity should not do anything in the round it is created in
-    sim_get(sim, target)->actioned_this_round = true;
+    child.actioned_this_round = true;
+    child.newborn = true;
+
+    if (!sim_take(sim, target, CELL_EMPTY, child, false)) return false;
 
     // Action message
     update_action_message(sim,
-                          sim_get(sim, parent), parent, REPRODUCE,
-                          sim_get(sim, target), target);
+                          &i, parent, REPRODUCE,
+                          &child, target);
+    sim->births++;
 
     return true;
 
@@ -320,44 +278,39 @@ bool breed(simulation * sim, const int parent[2]) {
 /**
  * Move a frog to a random free location which it can see
  * @param sim The simulation the frog is in
- * @param frog The coordinates of the frog
+ * @param frog The coordinates of the frog, updated to where it moved to
+ * @param around What the frog can see, from sim_scan with roam set
  * @return Success
  */
-bool move_f(simulation * sim, const int frog[2]) {
+bool move_f(simulation * sim, int frog[2], const neighbourhood * around) {
 
     // Input sanitisation
     if (!in_bounds(sim, frog)) return false;
     if (is_null(sim, frog)) return false;
-    if (sim_get(sim, frog)->inhabitant_type != FROG) return false;
 
-    coord_ll * visible_spaces = find_all(sim, EMPTY, frog, sim->config->FROG_VISION_DISTANCE);
+    inhabitant i = sim_get(sim, frog);
+    if (i.inhabitant_type != FROG) return false;
 
-    int size = coord_ll_size(visible_spaces);
 #ifdef DEBUG
-    printf("%d is visible_spaces size\n", size);
+    printf("%d is visible_spaces size\n", around->roam_count);
 #endif
 
     // There is no space to move too
-    if (size == 0) {
-        coord_ll_free(visible_spaces);
-        return false;
-    }
-
-    int target[2];
-    coord_ll * chosen = coord_ll_get(visible_spaces, dice_roll(size));
-    target[0] = chosen->values[0];
-    target[1] = chosen->values[1];
+    if (around->roam_count == 0) return false;
 
-    coord_ll_free(visible_spaces);
+    // The scan has already picked a free space at random
+    int target[2] = {around->roam[0], around->roam[1]};
 
-    free_inhabitant(sim_get(sim, target));
-    sim_set(sim, target, sim_get(sim, frog));
-    sim_set(sim, frog, NULL);
+    if (!sim_take(sim, target, CELL_EMPTY, i, true)) return false;
+    sim_clear(sim, frog);
 
     update_action_message(sim,
-                          sim_get(sim, target), frog, MOVE,
+                          &i, frog, MOVE,
                           NULL, target);
 
+    frog[0] = target[0];
+    frog[1] = target[1];
+
     return true;
 
 }
@@ -368,40 +321,44 @@ bool move_f(simulation * sim, const int frog[2]) {
  * If this isn't possible, perform one recursive call with a new random legal direction
  * If none are found return false
  * @param sim The simulation the slug is in
- * @param slug The coordinates of the slug
+ * @param slug The coordinates of the slug, updated to where it moved to
  * @return Success
  */
-bool move_s(simulation * sim, const int slug[2]) {
+bool move_s(simulation * sim, int slug[2]) {
 
     // Input sanitisation
     if (!in_bounds(sim, slug)) return false;
     if (is_null(sim, slug)) return false;
-    if (sim_get(sim, slug)->inhabitant_type != SLUG) return false;
 
     int _coord[2];
-    inhabitant * i = sim_get(sim, slug);
+    inhabitant i = sim_get(sim, slug);
+    if (i.inhabitant_type != SLUG) return false;
 
     _coord[0] = slug[0];
     _coord[1] = slug[1];
 
-    if (i->next_move != STATIONARY) {
+    if (i.next_move != STATIONARY) {
 
-        change_pos(_coord, i->next_move);
-        if (in_bounds(sim, (_coord))) {
+        change_pos(_coord, i.next_move);
+        // Wrapping keeps the new position on the garden if the edges are joined
+        if (sim_wrap(sim, _coord)) {
             if (is_null(sim, _coord)) {
 
-                free_inhabitant(sim_get(sim, _coord));
-                sim_set(sim, _coord, sim_get(sim, slug));
-                sim_set(sim, slug, NULL);
+                // Someone else got there first in an async round, so stay put
+                if (!sim_take(sim, _coord, CELL_EMPTY, i, true)) return false;
+                sim_clear(sim, slug);
 
 #ifdef DEBUG
-                printf("MOVE TO %d, %d\nDIrection is %d\n", _coord[0], _coord[1], i->next_move);
+                printf("MOVE TO %d, %d\nDIrection is %d\n", _coord[0], _coord[1], i.next_move);
 #endif
 
                 update_action_message(sim,
-                                      sim_get(sim, _coord), slug, MOVE,
+                                      &i, slug, MOVE,
                                       NULL, _coord);
 
+                slug[0] = _coord[0];
+                slug[1] = _coord[1];
+
                 return true;
 
             }
@@ -411,7 +368,7 @@ bool move_s(simulation * sim, const int slug[2]) {
     }
 
     // Next move was not legal OR next_move was 'stationary'
-    i->next_move = STATIONARY;
+    i.next_move = STATIONARY;
     int legal_moves = 15;
 
     // I am going to do bit operations.
@@ -425,7 +382,7 @@ bool move_s(simulation * sim, const int slug[2]) {
 
             // Check if that direction is a legal potential move
             change_pos(_coord, b);
-            if (in_bounds(sim, _coord))
+            if (sim_wrap(sim, _coord))
                 if (is_null(sim, _coord))
                     continue;
 
@@ -439,33 +396,19 @@ bool move_s(simulation * sim, const int slug[2]) {
 
     // No adjacent free squares
     if (!legal_moves) {
+        sim_update(sim, slug, i);
         return false;
     }
 
 
-    i->next_move = pick_random_bit(legal_moves);
+    i.next_move = pick_random_bit(&sim->rng, legal_moves);
+    // Still its turn, so the cell is kept until it is written back
+    sim_update(sim, slug, i);
 #ifdef DEBUG
-    printf("NEXT MOVE IS %d\n", i->next_move);
+    printf("NEXT MOVE IS %d\n", i.next_move);
 #endif
     return move_s(sim, slug);
 
 }
 
 
-/**
- * Function called when an inhabitant dies
- * @param sim The simulation the inhabitant is in
- * @param coord Coordinates of the inhabitant
- */
-void die(simulation * sim, const int coord[2]) {
-
-    update_action_message(sim,
-                          sim_get(sim, coord), coord, DIED,
-                          NULL, NULL);
-
-    free_inhabitant(sim_get(sim, coord));
-    sim_set(sim, coord, NULL);
-
-}
-
-
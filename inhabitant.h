@@ -21,18 +21,16 @@
 
 
 // Creation
-inhabitant * create_inhabitant(INHABITANT_TYPE i_type, int initial_age, DIRECTION lastMove);
-void free_inhabitant(inhabitant * i);
+inhabitant create_inhabitant(INHABITANT_TYPE i_type, int initial_age, DIRECTION lastMove);
 
 // Action 'controller'
 void inhabitant_action(simulation * sim, const int coord[2]);
 
 // Actions
-bool eat(simulation * sim, const int hungry[2]);
-bool breed(simulation * sim, const int parent[2]);
-bool move_f(simulation * sim, const int frog[2]);
-bool move_s(simulation * sim, const int slug[2]);
-void die(simulation * sim, const int coord[2]);
+bool eat(simulation * sim, int hungry[2], const neighbourhood * around);
+bool breed(simulation * sim, const int parent[2], const neighbourhood * around);
+bool move_f(simulation * sim, int frog[2], const neighbourhood * around);
+bool move_s(simulation * sim, int slug[2]);
 
 
 
@@ -10,8 +10,10 @@
 #include <string.h>
 #include <time.h>
 
+#include "branch.h"
 #include "buildinfo.h" // Contains preprocessor 'DEBUG' switch
 #include "config.h"
+#include "engine.h"
 #include "game_control.h"
 #include "inhabitant.h"
 #include "simulation.h"
@@ -25,19 +27,96 @@
 int main(int argc, char **argv) {
 
     // Thanks Neal for these 2 lines
-    // Seed is program run time
+    // Seed is program run time, unless one is given with --seed
     time_t t = time(0);
-    srand(t);
+    uint64_t seed = (uint64_t) t;
 
 
-    char configfile[256];
+    char configfile[256] = "";
     bool run_3_mode = false; // for --3 mode
+    int replicas = 1;
+    char ensemble_file[256] = "";
+    char series_file[256] = "";
+    char heatmap_prefix[256] = "";
+    int heatmap_every = 1;
+    int heatmap_block = 1;
+    char clusters_file[256] = "";
+    int clusters_every = 1;
+    bool clusters_diagonal = false;
+
+    for (int a = 1; a < argc; a++) {
+
+        if (!strcmp(argv[a], "--3")) {
+            run_3_mode = true; // for --3 mode
+            continue;
+        }
+
+        // Same seed and config give the same garden every time
+        if (!strcmp(argv[a], "--seed") && a + 1 < argc) {
+            seed = strtoull(argv[++a], NULL, 10);
+            continue;
+        }
+
+        // Jump mode runs this many copies of the garden, each with the next seed, unless it is kept in a file
+        if (!strcmp(argv[a], "--replicas") && a + 1 < argc) {
+            replicas = (int) strtol(argv[++a], NULL, 10);
+            if (replicas < 1) replicas = 1;
+            continue;
+        }
+
+        // Every round of the garden is written to this file
+        if (!strcmp(argv[a], "--series") && a + 1 < argc) {
+            strncpy(series_file, argv[++a], 255);
+            series_file[255] = '\000';
+            continue;
+        }
 
-    if (argc > 1) {
+        // Where everything has been is written to images starting with this when the game ends
+        if (!strcmp(argv[a], "--heatmap") && a + 1 < argc) {
+            strncpy(heatmap_prefix, argv[++a], 255);
+            heatmap_prefix[255] = '\000';
+            continue;
+        }
 
-        if (!strcmp(argv[1], "--3")) run_3_mode = true; // for --3 mode
+        // Only look every this many rounds
+        if (!strcmp(argv[a], "--heatmap-every") && a + 1 < argc) {
+            heatmap_every = (int) strtol(argv[++a], NULL, 10);
+            continue;
+        }
+
+        // Each pixel is a square of this many cells across
+        if (!strcmp(argv[a], "--heatmap-block") && a + 1 < argc) {
+            heatmap_block = (int) strtol(argv[++a], NULL, 10);
+            continue;
+        }
+
+        // The clusters of each species are written to this file
+        if (!strcmp(argv[a], "--clusters") && a + 1 < argc) {
+            strncpy(clusters_file, argv[++a], 255);
+            clusters_file[255] = '\000';
+            continue;
+        }
+
+        // Only find them every this many rounds
+        if (!strcmp(argv[a], "--clusters-every") && a + 1 < argc) {
+            clusters_every = (int) strtol(argv[++a], NULL, 10);
+            continue;
+        }
 
-        strncpy(configfile, argv[1], 255);
+        // Cells touching at a corner are in the same cluster
+        if (!strcmp(argv[a], "--clusters-diagonal")) {
+            clusters_diagonal = true;
+            continue;
+        }
+
+        // Branch mode and jump mode with replicas write how each species spreads out over them to this file
+        if (!strcmp(argv[a], "--ensemble") && a + 1 < argc) {
+            strncpy(ensemble_file, argv[++a], 255);
+            ensemble_file[255] = '\000';
+            continue;
+        }
+
+        strncpy(configfile, argv[a], 255);
         configfile[255] = '\000';
     }
 
@@ -47,10 +126,10 @@ int main(int argc, char **argv) {
     simulation * sim3 = NULL; // for --3 mode
 
     // If the config file is in the args
-    if (argc > 1) {
-        if (file_exists(argv[1]))
-            sim1 = read_file(argv[1]);
-    } else {
+    if (strcmp(configfile, "")) {
+        if (file_exists(configfile))
+            sim1 = read_file(configfile);
+    } else if (!run_3_mode) {
         sim1 = create_simulation(12, 12);
     }
 
@@ -72,11 +151,38 @@ int main(int argc, char **argv) {
     }
 
 
+    // Every garden has its own random number generator, the --3 gardens take the seeds after
+    if (sim1 != NULL) random_seed(&sim1->rng, seed);
+    if (sim2 != NULL) random_seed(&sim2->rng, seed + 1);
+    if (sim3 != NULL) random_seed(&sim3->rng, seed + 2);
+
+    // Replicas of a garden kept in a file would all map the same file, and run over each other
+    if (sim1 != NULL && sim1->file != NULL && replicas > 1) {
+        printf("Gardens kept in a file can't have replicas, running just the one\n");
+        replicas = 1;
+    }
+
+    if (sim1 != NULL && strcmp(series_file, "")) {
+        sim1->series = series_open(sim1, series_file);
+        if (sim1->series == NULL) printf("Couldn't open %s for the series\n", series_file);
+    }
+
+    if (sim1 != NULL && strcmp(heatmap_prefix, "")) {
+        sim1->heatmap = heatmap_create(sim1, heatmap_every, heatmap_block);
+        if (sim1->heatmap == NULL) printf("Couldn't make a heatmap that big, try a bigger --heatmap-block\n");
+    }
+
+    if (sim1 != NULL && strcmp(clusters_file, "")) {
+        sim1->clusters = cluster_log_open(clusters_file, clusters_every, clusters_diagonal);
+        if (sim1->clusters == NULL) printf("Couldn't open %s for the clusters\n", clusters_file);
+    }
+
+
     clear_output();
 
     printf("Welcome to Garden Paradise (");
     print_version();
-    printf(")\n\nPlease select a game mode!\n'round' | 'move':\n");
+    printf(")\n\nPlease select a game mode!\n'round' | 'move' | 'jump' | 'branch':\n");
 
 
     // Get the mode to run the game in
@@ -110,6 +216,7 @@ int main(int argc, char **argv) {
             terminal_header();
             pretty_print(sim1);
             printf("End of round %d\n", sim1->round);
+            engine_print_stats(sim1);
 
             // --3 mode code
             if (run_3_mode) {
@@ -135,44 +242,41 @@ int main(int argc, char **argv) {
         // Need a check for quitting as this uses nested for loops
         bool quit = false;
 
-        int temp[2];
+        garden_walk walk;
 
         // Until quit
         for (;;) {
-            // For each coordinate pair
-            for (int x = 0; x < sim1->x; x++) {
-                if (quit) break;
-                for (int y = 0; y < sim1->y; y++) {
-                    temp[0] = x;
-                    temp[1] = y;
-                    // That isn't null
-                    if (sim_get(sim1, temp) == NULL) continue;
-
-                    // Do 1 action, print, wait for input
-                    inhabitant_action(sim1, temp);
+            // For each inhabitant
+            sim_walk_start(sim1, &walk);
+            while (sim_walk_next(sim1, &walk)) {
+
+                // Do 1 action, print, wait for input
+                inhabitant_action(sim1, walk.pos);
 #ifndef DEBUG
-                    clear_output();
+                clear_output();
 #endif
-                    terminal_header();
-                    pretty_print(sim1);
-                    // Formatted action message
-                    print_last_action_message(sim1);
+                terminal_header();
+                pretty_print(sim1);
+                // Formatted action message
+                print_last_action_message(sim1);
 
-                    // Prompt for escape. If 'q' or 'Q', mark the loop for quitting and then break
-                    if ((quit = quit_sim_loop())) break;
+                // Prompt for escape. If 'q' or 'Q', mark the loop for quitting and then break
+                if ((quit = quit_sim_loop())) break;
 
-                }
             }
+            sim_walk_end(&walk);
 
-            // Reset the sim
-            reset_actions(sim1);
-            if (quit) break;
+            // A round cut short is only settled, the series, heatmap and clusters see whole rounds
+            if (quit) {
+                reset_actions(sim1);
+                break;
+            }
+            garden_round_end(sim1);
 
 
             // Check for empty grid
-            coord_ll * tcl = find_all(sim1, EMPTY, (int[]) {-1, -1}, (sim1->x > sim1->y ? sim1->x : sim1->y) + 1 );
-            // If the entire grid is empty:
-            if (coord_ll_size(tcl) == sim1->x * sim1->y) {
+            // (counted directly, a search from off the grid doesn't work when the edges wrap)
+            if (sim_population(sim1) == 0) {
 #ifndef DEBUG
                 clear_output();
 #endif
@@ -182,16 +286,99 @@ int main(int argc, char **argv) {
                 printf("\nSimulation is empty! Are you sure you wish to continue?\n");
                 if ((quit = quit_sim_loop())) break;
             }
-            coord_ll_free(tcl);
         }
     }
 
+    // Jump mode
+    else if (!strcmp(runMode, "jump")) {
+
+        char target[16];
+        printf("Round to jump to: ");
+        if (fgets(target, 16, stdin) == NULL) target[0] = '\000';
+
+        int target_round = (int) strtol(target, NULL, 10);
+
+        // Finding a cycle lets the rest of the rounds be skipped
+        // Replicas are run side by side instead, so they don't look for one
+        int cycle = 0;
+        simulation ** all = malloc((size_t) replicas * sizeof(simulation *));
+        all[0] = sim1;
+        for (int r = 1; r < replicas; r++) {
+            all[r] = strcmp(configfile, "") ? read_file(configfile) : create_simulation(12, 12);
+
+            // Carry on with the replicas there are
+            if (all[r] == NULL) {
+                printf("Couldn't load replica %d, running %d\n", r, r);
+                replicas = r;
+                break;
+            }
+            random_seed(&all[r]->rng, seed + (uint64_t) r);
+        }
+
+        if (replicas > 1) {
+            FILE * series = strcmp(ensemble_file, "") ? fopen(ensemble_file, "w") : NULL;
+            if (strcmp(ensemble_file, "") && series == NULL) printf("Couldn't open %s for the ensemble\n", ensemble_file);
+            garden_jump_all(all, replicas, target_round, series);
+            if (series != NULL) fclose(series);
+        } else cycle = garden_jump(sim1, target_round);
+
+#ifndef DEBUG
+        clear_output();
+#endif
+        terminal_header();
+        pretty_print(sim1);
+        printf("End of round %d\n", sim1->round);
+        if (cycle) printf("The garden repeats every %d rounds\n", cycle);
+
+        for (int r = 1; r < replicas; r++) {
+            printf("Replica %d: %d inhabitants\n", r, sim_population(all[r]));
+            free_simulation(all[r]);
+        }
+        free(all);
+    }
+
+    // Branch mode
+    else if (!strcmp(runMode, "branch")) {
+
+        char line[16];
+        printf("Round to branch at: ");
+        if (fgets(line, 16, stdin) == NULL) line[0] = '\000';
+        int branch_round = (int) strtol(line, NULL, 10);
+
+        printf("Number of branches: ");
+        if (fgets(line, 16, stdin) == NULL) line[0] = '\000';
+        int branches = (int) strtol(line, NULL, 10);
+
+        printf("Rounds to run each branch for: ");
+        if (fgets(line, 16, stdin) == NULL) line[0] = '\000';
+        int rounds = (int) strtol(line, NULL, 10);
+
+        // Every branch carries on from this garden, which is only run once
+        garden_jump(sim1, branch_round);
+        FILE * series = strcmp(ensemble_file, "") ? fopen(ensemble_file, "w") : NULL;
+        branch_result * results = branch_run(sim1, branches, rounds, series);
+        if (series != NULL) fclose(series);
+
+#ifndef DEBUG
+        clear_output();
+#endif
+        terminal_header();
+        pretty_print(sim1);
+        printf("Branched at round %d\n", sim1->round);
+        if (results != NULL) branch_print(results, branches);
+        else printf("This garden can't be branched\n");
+        branch_free(results, branches);
+    }
+
     // Reject all except valid modes
     else {
         printf("Sorry, that's not a valid mode!\n\n");
     }
 
 
+    if (sim1 != NULL && sim1->heatmap != NULL && !heatmap_write(sim1->heatmap, heatmap_prefix))
+        printf("Couldn't write the heatmap to %s\n", heatmap_prefix);
+
     printf("Thank you for playing!\n");
 
 
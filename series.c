@@ -0,0 +1,77 @@
+//
+// Created on 19/10/2026.
+//
+
+#include <stdio.h>
+
+#include "series.h"
+#include "simulation.h"
+
+
+struct SERIES_WRITER {
+
+    FILE * file;
+    char * buffer;
+
+};
+
+
+/**
+ * Start writing every round of a simulation to a CSV file
+ * Each line has the round, lettuce, young and mature slugs and frogs, the same split
+ * pretty_print shows, and how many were born, died and were eaten in the round
+ * @param sim The simulation
+ * @param filename The file, overwritten if it is already there
+ * @return The writer, NULL if the file couldn't be opened. Set it as sim->series
+ */
+series_writer * series_open(simulation * sim, const char * filename) {
+
+    FILE * file = fopen(filename, "w");
+    if (file == NULL) return NULL;
+
+    series_writer * out = malloc(sizeof(series_writer));
+    out->file = file;
+    out->buffer = malloc(SERIES_BUFFER_SIZE);
+    setvbuf(file, out->buffer, _IOFBF, SERIES_BUFFER_SIZE);
+    sim->births = 0;
+    sim->meals = 0;
+
+    fprintf(file, "round,lettuce,slugs,mature_slugs,frogs,mature_frogs,births,deaths,meals\n");
+
+    return out;
+
+}
+
+
+/**
+ * Write the line for the round that has just been run, before it is settled
+ * Births and meals are counted as they happen, and sim_census finds the rest in one walk
+ * @param sim The simulation
+ */
+void series_record(simulation * sim) {
+
+    garden_census census;
+    sim_census(sim, &census);
+
+    fprintf(sim->series->file, "%d,%d,%d,%d,%d,%d,%d,%d,%d\n", sim->round + 1, census.lettuce, census.slugs,
+            census.mature_slugs, census.frogs, census.mature_frogs, sim->births, census.deaths, sim->meals);
+
+    sim->births = 0;
+    sim->meals = 0;
+
+}
+
+
+/**
+ * Write out anything left and close a series
+ * @param series The writer, may be NULL
+ */
+void series_close(series_writer * series) {
+
+    if (series == NULL) return;
+
+    fclose(series->file);
+    free(series->buffer);
+    free(series);
+
+}
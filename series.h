@@ -0,0 +1,27 @@
+//
+// Created on 19/10/2026.
+//
+
+#ifndef GARDEN_PARADISE_SERIES_H
+#define GARDEN_PARADISE_SERIES_H
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "buildinfo.h"
+
+#include "global_structs.h"
+
+
+// Bytes written out at a time, a line is well under 100 so this is hundreds of rounds
+#define SERIES_BUFFER_SIZE (1 << 16)
+
+
+// Series functions
+series_writer * series_open(simulation * sim, const char * filename);
+void series_record(simulation * sim);
+void series_close(series_writer * series);
+
+
+#endif //GARDEN_PARADISE_SERIES_H
@@ -4,133 +4,1111 @@
 
 
 #include "simulation.h"
+#include "clusters.h"
+#include "engine.h"
+#include "heatmap.h"
+#include "series.h"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+// Largest radius with its own scan kernel, and so the deepest border a garden needs
+#define SCAN_KERNEL_MAX 4
+
+// Cells of a dense garden are claimed with compare and swap in async rounds
+#if defined(__GNUC__) || defined(__clang__)
+#define CELL_CAS(p, expected, value) \
+    __atomic_compare_exchange_n((p), (expected), (value), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define CELL_STORE(p, value) __atomic_store_n((p), (value), __ATOMIC_RELEASE)
+// Reads of cells another thread may be claiming, anything that depends on them goes through CELL_CAS
+#define CELL_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#else
+// No async rounds without pthreads, so nothing else can be changing the cell
+#define CELL_CAS(p, expected, value) (* (p) == * (expected) ? (* (p) = (value), true) : (* (expected) = * (p), false))
+#define CELL_STORE(p, value) (* (p) = (value))
+#define CELL_LOAD(p) (* (p))
+#endif
+
+// Claims are made on inhabitants and walls have none, so the two can share a bit
+_Static_assert(!(CELL_WALL & CELL_TYPE_MASK), "a wall must not look like an inhabitant");
+_Static_assert(CELL_BUSY == CELL_WALL, "test walls and claims with CELL_IS_WALL and CELL_IS_BUSY");
+
+// Rows of a dense garden with fewer than one EMPTY cell in this many are walked cell by cell,
+// the rest from their occupancy bits, which don't mispredict a branch on every cell
+#define WALK_FULL_RATIO 64
+
+// Tiled gardens keep each TILE_SIZE x TILE_SIZE square of cells together, row-major inside the tile
+#define TILE_BITS 3
+#define TILE_SIZE (1 << TILE_BITS)
+#define TILE_MASK (TILE_SIZE - 1)
+
+
+/**
+ * Pack an inhabitant into a cell
+ * Age and hunger stop at the largest value the cell can hold
+ * @param i The inhabitant
+ * @return The cell, CELL_EMPTY for an EMPTY inhabitant
+ */
+static cell cell_pack(const inhabitant i) {
+
+    if (i.inhabitant_type == EMPTY) return CELL_EMPTY;
+
+    cell age = i.age < 0 ? 0 : i.age > CELL_AGE_MAX ? CELL_AGE_MAX : (cell) i.age;
+    cell hunger = i.hunger < 0 ? 0 : i.hunger > CELL_HUNGER_MAX ? CELL_HUNGER_MAX : (cell) i.hunger;
+
+    return (cell) (i.inhabitant_type + 1) |
+           (cell) i.next_move << CELL_MOVE_SHIFT |
+           (i.actioned_this_round ? CELL_ACTIONED : 0) |
+           (i.newborn ? CELL_NEWBORN : 0) |
+           age << CELL_AGE_SHIFT |
+           hunger << CELL_HUNGER_SHIFT;
+
+}
+
+
+/**
+ * Unpack a cell into an inhabitant
+ * @param c The cell
+ * @return The inhabitant, EMPTY for CELL_EMPTY
+ */
+static inhabitant cell_unpack(const cell c) {
+
+    inhabitant out;
+    out.inhabitant_type = CELL_TYPE(c);
+    out.next_move = (DIRECTION) (c >> CELL_MOVE_SHIFT & CELL_MOVE_MASK);
+    out.age = (int) (c >> CELL_AGE_SHIFT & CELL_AGE_MAX);
+    out.hunger = (int) (c >> CELL_HUNGER_SHIFT & CELL_HUNGER_MAX);
+    out.actioned_this_round = (c & CELL_ACTIONED) != 0;
+    out.newborn = (c & CELL_NEWBORN) != 0;
+
+    return out;
+
+}
+
+
+/**
+ * What a cell becomes at the end of the round
+ * Anything that has had its turn, other than newborns, is a round older and hungrier
+ * @param c The cell
+ * @return The cell with age and hunger caught up and its flags cleared
+ */
+static cell cell_settle(cell c) {
+
+    if ((c & (CELL_ACTIONED | CELL_NEWBORN)) == CELL_ACTIONED) {
+        if ((c >> CELL_AGE_SHIFT & CELL_AGE_MAX) != CELL_AGE_MAX) c += 1u << CELL_AGE_SHIFT;
+        if ((c >> CELL_HUNGER_SHIFT & CELL_HUNGER_MAX) != CELL_HUNGER_MAX) c += 1u << CELL_HUNGER_SHIFT;
+    }
+
+    return c & ~(CELL_ACTIONED | CELL_NEWBORN);
+
+}
+
+
+/**
+ * Whether a settled cell has outlived its lifespan
+ * @param sim The simulation, for its config
+ * @param c The cell
+ * @return If whatever is in the cell dies before the next round
+ */
+static bool cell_dies(simulation * sim, const cell c) {
+
+    int age = (int) (c >> CELL_AGE_SHIFT & CELL_AGE_MAX);
+
+    switch (CELL_TYPE(c)) {
+        case SLUG:
+            return age > sim->config->SLUG_LIFESPAN;
+        case FROG:
+            return age > sim->config->FROG_LIFESPAN;
+        default:
+            // Lettuce live forever
+            return false;
+    }
+
+}
+
+
+/**
+ * Set up the occupancy of an empty dense garden
+ * @param sim The simulation
+ * @param bits If there should be a bit for every cell, not for file-backed gardens
+ */
+static void occupancy_init(simulation * sim, const bool bits) {
+
+    sim->row_population = calloc((size_t) sim->x, sizeof(* sim->row_population));
+
+    sim->occupied_words = (sim->y + 63) / 64;
+    sim->occupied = bits ? calloc((size_t) sim->x * (size_t) sim->occupied_words, sizeof(* sim->occupied)) : NULL;
+
+}
+
+
+/**
+ * Record a position of a dense garden being taken or freed
+ * Tiles running side by side in a parallel round share rows and words, so this is atomic
+ * @param sim The simulation
+ * @param pos The position
+ * @param taken If something is there now
+ */
+static void occupancy_mark(simulation * sim, const int pos[2], const bool taken) {
+
+    atomic_fetch_add_explicit(sim->row_population + pos[0], taken ? 1 : -1, memory_order_relaxed);
+
+    if (sim->occupied == NULL) return;
+
+    _Atomic uint64_t * word = sim->occupied + (size_t) pos[0] * sim->occupied_words + (pos[1] >> 6);
+    if (taken)
+        atomic_fetch_or_explicit(word, (uint64_t) 1 << (pos[1] & 63), memory_order_relaxed);
+    else
+        atomic_fetch_and_explicit(word, ~((uint64_t) 1 << (pos[1] & 63)), memory_order_relaxed);
+
+}
+
+
+/**
+ * Find the next position in part of a row of a dense garden that isn't EMPTY, from its occupancy bits
+ * @param sim The simulation
+ * @param x The row
+ * @param from The first column to look at
+ * @param to The column after the last one to look at
+ * @return The column, to if there isn't one
+ */
+static int occupancy_next(simulation * sim, const int x, const int from, const int to) {
+
+    if (from >= to) return to;
+
+    const _Atomic uint64_t * row = sim->occupied + (size_t) x * sim->occupied_words;
+    int w = from >> 6;
+    int last = (to - 1) >> 6;
+    uint64_t bits = atomic_load_explicit(row + w, memory_order_relaxed) >> (from & 63) << (from & 63);
+
+    while (!bits) {
+        if (++w > last) return to;
+        bits = atomic_load_explicit(row + w, memory_order_relaxed);
+    }
+
+    int y = (w << 6) + chunk_first_bit(bits);
+    return y < to ? y : to;
+
+}
+
+
+/**
+ * Remove a settled cell from the garden if it has outlived its lifespan
+ * @param sim The simulation
+ * @param cells The run of cells being settled
+ * @param n The index of the cell in the run
+ * @param origin The position of the first cell in the run
+ * @param width The number of cells in each row of the run
+ * @return 1 if it died, otherwise 0
+ */
+static int reap_cell(simulation * sim, cell * cells, const int n, const int origin[2], const int width) {
+
+    if (!cell_dies(sim, cells[n])) return 0;
+
+    int pos[2] = {origin[0] + (int) (n / width), origin[1] + (int) (n % width)};
+
+    sim->hash ^= sim_hash_cell(sim, pos, cells[n]);
+    cells[n] = CELL_EMPTY;
+    if (sim->row_population != NULL) occupancy_mark(sim, pos, false);
+
+    return 1;
+
+}
+
+
+/**
+ * Settle a run of cells, several at a time where the processor allows it
+ * Each lane does exactly what cell_settle does, without any branches, and works out
+ * whether the cell has outlived its lifespan. Only the rare groups of lanes with a
+ * death in them drop back to reap_cell
+ * @param sim The simulation
+ * @param cells The cells
+ * @param count How many
+ * @param origin The position of the first cell
+ * @param width The number of cells in each row
+ * @return How many inhabitants died
+ */
+static int settle_cells(simulation * sim, cell * cells, const int count, const int origin[2], const int width) {
+
+    int n = 0;
+    int deaths = 0;
+
+#if defined(__AVX2__)
+    const __m256i flags = _mm256_set1_epi32((int) (CELL_ACTIONED | CELL_NEWBORN));
+    const __m256i actioned = _mm256_set1_epi32((int) CELL_ACTIONED);
+    const __m256i age_max = _mm256_set1_epi32((int) ((cell) CELL_AGE_MAX << CELL_AGE_SHIFT));
+    const __m256i age_one = _mm256_set1_epi32((int) (1u << CELL_AGE_SHIFT));
+    const __m256i hunger_max = _mm256_set1_epi32((int) ((cell) CELL_HUNGER_MAX << CELL_HUNGER_SHIFT));
+    const __m256i hunger_one = _mm256_set1_epi32((int) (1u << CELL_HUNGER_SHIFT));
+
+    const __m256i type_mask = _mm256_set1_epi32((int) CELL_TYPE_MASK);
+    const __m256i slug = _mm256_set1_epi32(SLUG + 1);
+    const __m256i frog = _mm256_set1_epi32(FROG + 1);
+    const __m256i slug_lifespan = _mm256_set1_epi32(sim->config->SLUG_LIFESPAN);
+    const __m256i frog_lifespan = _mm256_set1_epi32(sim->config->FROG_LIFESPAN);
+    const __m256i forever = _mm256_set1_epi32(CELL_AGE_MAX);
+
+    for (; n + 8 <= count; n += 8) {
+        __m256i c = _mm256_loadu_si256((__m256i *) (cells + n));
+
+        // All ones in the lanes that age
+        __m256i ages = _mm256_cmpeq_epi32(_mm256_and_si256(c, flags), actioned);
+
+        // Leave out the lanes that are already at the maximum
+        __m256i full_age = _mm256_cmpeq_epi32(_mm256_and_si256(c, age_max), age_max);
+        __m256i full_hunger = _mm256_cmpeq_epi32(_mm256_and_si256(c, hunger_max), hunger_max);
+
+        c = _mm256_add_epi32(c, _mm256_and_si256(_mm256_andnot_si256(full_age, ages), age_one));
+        c = _mm256_add_epi32(c, _mm256_and_si256(_mm256_andnot_si256(full_hunger, ages), hunger_one));
+        c = _mm256_andnot_si256(flags, c);
+        _mm256_storeu_si256((__m256i *) (cells + n), c);
+
+        // Lifespan of each lane, lettuce and empty cells never reach theirs
+        __m256i type = _mm256_and_si256(c, type_mask);
+        __m256i is_slug = _mm256_cmpeq_epi32(type, slug);
+        __m256i is_frog = _mm256_cmpeq_epi32(type, frog);
+        __m256i lifespan = _mm256_or_si256(
+                _mm256_or_si256(_mm256_and_si256(is_slug, slug_lifespan), _mm256_and_si256(is_frog, frog_lifespan)),
+                _mm256_andnot_si256(_mm256_or_si256(is_slug, is_frog), forever));
+
+        __m256i dead = _mm256_cmpgt_epi32(_mm256_srli_epi32(_mm256_and_si256(c, age_max), CELL_AGE_SHIFT), lifespan);
+        if (_mm256_movemask_epi8(dead))
+            for (int k = n; k < n + 8; k++)
+                deaths += reap_cell(sim, cells, k, origin, width);
+    }
+#elif defined(__SSE2__)
+    const __m128i flags = _mm_set1_epi32((int) (CELL_ACTIONED | CELL_NEWBORN));
+    const __m128i actioned = _mm_set1_epi32((int) CELL_ACTIONED);
+    const __m128i age_max = _mm_set1_epi32((int) ((cell) CELL_AGE_MAX << CELL_AGE_SHIFT));
+    const __m128i age_one = _mm_set1_epi32((int) (1u << CELL_AGE_SHIFT));
+    const __m128i hunger_max = _mm_set1_epi32((int) ((cell) CELL_HUNGER_MAX << CELL_HUNGER_SHIFT));
+    const __m128i hunger_one = _mm_set1_epi32((int) (1u << CELL_HUNGER_SHIFT));
+
+    const __m128i type_mask = _mm_set1_epi32((int) CELL_TYPE_MASK);
+    const __m128i slug = _mm_set1_epi32(SLUG + 1);
+    const __m128i frog = _mm_set1_epi32(FROG + 1);
+    const __m128i slug_lifespan = _mm_set1_epi32(sim->config->SLUG_LIFESPAN);
+    const __m128i frog_lifespan = _mm_set1_epi32(sim->config->FROG_LIFESPAN);
+    const __m128i forever = _mm_set1_epi32(CELL_AGE_MAX);
+
+    for (; n + 4 <= count; n += 4) {
+        __m128i c = _mm_loadu_si128((__m128i *) (cells + n));
+
+        // All ones in the lanes that age
+        __m128i ages = _mm_cmpeq_epi32(_mm_and_si128(c, flags), actioned);
+
+        // Leave out the lanes that are already at the maximum
+        __m128i full_age = _mm_cmpeq_epi32(_mm_and_si128(c, age_max), age_max);
+        __m128i full_hunger = _mm_cmpeq_epi32(_mm_and_si128(c, hunger_max), hunger_max);
+
+        c = _mm_add_epi32(c, _mm_and_si128(_mm_andnot_si128(full_age, ages), age_one));
+        c = _mm_add_epi32(c, _mm_and_si128(_mm_andnot_si128(full_hunger, ages), hunger_one));
+        c = _mm_andnot_si128(flags, c);
+        _mm_storeu_si128((__m128i *) (cells + n), c);
+
+        // Lifespan of each lane, lettuce and empty cells never reach theirs
+        __m128i type = _mm_and_si128(c, type_mask);
+        __m128i is_slug = _mm_cmpeq_epi32(type, slug);
+        __m128i is_frog = _mm_cmpeq_epi32(type, frog);
+        __m128i lifespan = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(is_slug, slug_lifespan), _mm_and_si128(is_frog, frog_lifespan)),
+                _mm_andnot_si128(_mm_or_si128(is_slug, is_frog), forever));
+
+        __m128i dead = _mm_cmpgt_epi32(_mm_srli_epi32(_mm_and_si128(c, age_max), CELL_AGE_SHIFT), lifespan);
+        if (_mm_movemask_epi8(dead))
+            for (int k = n; k < n + 4; k++)
+                deaths += reap_cell(sim, cells, k, origin, width);
+    }
+#endif
+
+    // Whatever is left over, or everything without SIMD
+    for (; n < count; n++) {
+        cells[n] = cell_settle(cells[n]);
+        deaths += reap_cell(sim, cells, n, origin, width);
+    }
+
+    return deaths;
+
+}
+
+
+/**
+ * Where a position is in a dense garden
+ * Positions in the border, up to pad cells (or a tile) off the garden, can be used too
+ * @param sim The simulation
+ * @param x The row
+ * @param y The column
+ * @return The index of the cell from sim->garden
+ */
+static inline ptrdiff_t garden_index(const simulation * sim, const int x, const int y) {
+
+    if (!sim->tiled) return (ptrdiff_t) x * sim->stride + y;
+
+    // Counted from the ring of wall tiles, so nothing in the border is negative
+    int tx = x + TILE_SIZE;
+    int ty = y + TILE_SIZE;
+
+    return ((ptrdiff_t) (tx >> TILE_BITS) * sim->stride + (ty >> TILE_BITS)) << (2 * TILE_BITS) |
+           (tx & TILE_MASK) << TILE_BITS | (ty & TILE_MASK);
+
+}
+
+
+/**
+ * Get the cell at a position that is known to be on the garden
+ * @param sim The simulation
+ * @param coordinate The coordinates, already bounds checked or wrapped
+ * @return The cell, CELL_EMPTY if there isn't anything there
+ */
+static cell cell_at(simulation * sim, const int coordinate[2]) {
+
+    if (sim->chunks == NULL) return CELL_LOAD(sim->garden + garden_index(sim, coordinate[0], coordinate[1]));
+
+    chunk * c = chunk_map_get(sim->chunks, coordinate[0] >> CHUNK_BITS, coordinate[1] >> CHUNK_BITS);
+    if (c == NULL) return CELL_EMPTY;
+
+    return c->cells[coordinate[0] & CHUNK_MASK][coordinate[1] & CHUNK_MASK];
+
+}
+
+
+/**
+ * Lay an in-memory dense garden out again with a border of walls pad cells deep
+ * Neighbourhood kernels can then read up to pad cells off the edge without checking
+ * @param sim The simulation, whose cells are copied across
+ * @param pad How deep the border is
+ */
+static void sim_pad_garden(simulation * sim, const int pad) {
+
+    if (sim->garden != NULL && pad == sim->pad) return;
+
+    int stride = sim->y + 2 * pad;
+    size_t size = (size_t) (sim->x + 2 * pad) * (size_t) stride;
+    cell * base = malloc(size * sizeof(cell));
+
+    for (size_t n = 0; n < size; n++) base[n] = CELL_WALL;
+
+    cell * garden = base + (ptrdiff_t) pad * stride + pad;
+    for (int x = 0; x < sim->x; x++) {
+        if (sim->garden == NULL)
+            memset(garden + (ptrdiff_t) x * stride, 0, (size_t) sim->y * sizeof(cell));
+        else
+            memcpy(garden + (ptrdiff_t) x * stride, sim->garden + (ptrdiff_t) x * sim->stride,
+                   (size_t) sim->y * sizeof(cell));
+    }
+
+    if (sim->garden != NULL) free(sim->garden - ((ptrdiff_t) sim->pad * sim->stride + sim->pad));
+
+    sim->garden = garden;
+    sim->pad = pad;
+    sim->stride = stride;
+
+}
+
+
+/**
+ * Find the block of memory an in-memory dense garden is in, border and all
+ * Both layouts keep the rows in order, so any run of rows is one stretch of the block
+ * @param sim The simulation
+ * @param block Set to the start of the block, NULL for sparse and file-backed gardens
+ * @return How many cells are in the block
+ */
+size_t sim_garden_block(const simulation * sim, cell ** block) {
+
+    * block = NULL;
+    if (sim->garden == NULL || sim->file != NULL) return 0;
+
+    * block = sim->garden - ((ptrdiff_t) sim->pad * sim->stride + sim->pad);
+
+    if (sim->tiled)
+        return (size_t) ((sim->x + TILE_MASK) / TILE_SIZE + 2) * (size_t) sim->stride * TILE_SIZE * TILE_SIZE;
+    return (size_t) (sim->x + 2 * sim->pad) * (size_t) sim->stride;
+
+}
+
+
+/**
+ * Where a row of an in-memory dense garden starts in its block, see sim_garden_block
+ * @param sim The simulation
+ * @param x The row, rounded down to a whole tile for tiled gardens
+ * @return How many cells into the block
+ */
+size_t sim_garden_offset(const simulation * sim, const int x) {
+
+    // From the start of the row's border, the wall at its left
+    if (sim->tiled) return (size_t) garden_index(sim, x & ~TILE_MASK, -TILE_SIZE);
+    return (size_t) ((ptrdiff_t) (x + sim->pad) * sim->stride);
+
+}
+
+
+/**
+ * Move an in-memory dense garden into a copy of its block, freeing the old one
+ * @param sim The simulation
+ * @param block The copy, from malloc
+ */
+void sim_move_garden(simulation * sim, cell * block) {
+
+    cell * old;
+    sim_garden_block(sim, &old);
+
+    sim->garden = block + (sim->garden - old);
+    free(old);
+
+}
+
+
+/**
+ * Set up everything in a simulation except where the inhabitants are stored
+ * @param x Dimension of the simulation
+ * @param y Dimension of the simulation
+ * @return A pointer to the simulation
+ */
+static simulation * create_empty_simulation(const int x, const int y) {
+
+    simulation * out = malloc(sizeof(simulation));
+
+    out->x = x;
+    out->y = y;
+
+    out->garden = NULL;
+    out->tiled = false;
+    out->pad = 0;
+    out->stride = y;
+    out->row_population = NULL;
+    out->occupied = NULL;
+    out->occupied_words = 0;
+    out->chunks = NULL;
+    out->file = NULL;
+
+    out->round = 0;
+
+    // Seeded properly by whoever made the simulation, see random_seed
+    random_seed(&out->rng, 0);
+
+    skip_counter_init(&out->lettuce_grow);
+    skip_counter_init(&out->slug_reproduce);
+    skip_counter_init(&out->frog_reproduce);
+
+    // An empty garden hashes to 0
+    out->hash = 0;
+
+    out->config = NULL;
+    sim_set_config(out, create_empty_config());
+
+    // Nothing has happened yet
+    out->last_action.set = false;
+
+    out->async = false;
+
+    out->engine = NULL;
+    out->series = NULL;
+    out->births = 0;
+    out->meals = 0;
+    out->heatmap = NULL;
+    out->clusters = NULL;
+
+
+    return out;
+
+}
+
+
+/**
+ * Create a simulation struct and return a pointer too it
+ * Simulations are stored on the heap, so various functions are used to hide malloc/free -ing
+ * @param x Dimension of the simulation
+ * @param y Dimension of the simulation
+ * @return A pointer to the simulation
+ */
+simulation * create_simulation(const int x, const int y) {
+
+    simulation * out = create_empty_simulation(x, y);
+
+    // Zeroed cells are EMPTY, the border is sized for the config by sim_set_config
+    sim_pad_garden(out, 1);
+    occupancy_init(out, true);
+
+    return out;
+
+}
+
+
+/**
+ * Create a simulation that stores the garden in small square tiles rather than row by row
+ * Everything within a few cells of an inhabitant is in a handful of tiles, instead of being
+ * spread over rows that are a whole garden width apart. A ring of tiles full of walls goes
+ * around the garden, so scans can look off the edge
+ * @param x Dimension of the simulation
+ * @param y Dimension of the simulation
+ * @return A pointer to the simulation
+ */
+simulation * create_tiled_simulation(const int x, const int y) {
+
+    simulation * out = create_empty_simulation(x, y);
+
+    out->tiled = true;
+    // Tiles in each row of tiles, including the walls at either end
+    out->stride = (y + TILE_MASK) / TILE_SIZE + 2;
+
+    size_t tiles = (size_t) ((x + TILE_MASK) / TILE_SIZE + 2) * (size_t) out->stride;
+    out->garden = malloc(tiles * TILE_SIZE * TILE_SIZE * sizeof(cell));
+
+    // Walls everywhere, then the garden itself is cleared
+    for (size_t n = 0; n < tiles * TILE_SIZE * TILE_SIZE; n++) out->garden[n] = CELL_WALL;
+    for (int i = 0; i < x; i++)
+        for (int j = 0; j < y; j++)
+            out->garden[garden_index(out, i, j)] = CELL_EMPTY;
+
+    occupancy_init(out, true);
+
+    return out;
+
+}
+
+
+/**
+ * Create a simulation that only stores the chunks of the garden that have inhabitants
+ * Memory grows with the population rather than the size, so x and y can be huge
+ * @param x Dimension of the simulation
+ * @param y Dimension of the simulation
+ * @return A pointer to the simulation
+ */
+simulation * create_sparse_simulation(const int x, const int y) {
+
+    simulation * out = create_empty_simulation(x, y);
+
+    out->chunks = chunk_map_init();
+
+    return out;
+
+}
+
+
+/**
+ * Create a simulation whose garden is kept in a memory-mapped file
+ * If the file already holds a garden of this size, that garden and its round are carried on
+ * @param x Dimension of the simulation
+ * @param y Dimension of the simulation
+ * @param filename The file
+ * @return A pointer to the simulation, NULL if the file couldn't be used
+ */
+simulation * create_mapped_simulation(const int x, const int y, const char * filename) {
+
+    garden_file * file = garden_file_open(filename, x, y);
+    if (file == NULL) return NULL;
+
+    simulation * out = create_empty_simulation(x, y);
+
+    out->file = file;
+    out->garden = file->cells;
+    out->round = file->header->round;
+
+    // The hash and row populations aren't stored, so work them out from what is already there
+    occupancy_init(out, false);
+    for (int pos[2] = {0, 0}; pos[0] < x; pos[0]++) {
+        if (pos[0] % GARDEN_FILE_READAHEAD == 0)
+            garden_file_prefetch(file, pos[0] + GARDEN_FILE_READAHEAD, GARDEN_FILE_READAHEAD);
+
+        for (pos[1] = 0; pos[1] < y; pos[1]++) {
+            cell c = out->garden[(ptrdiff_t) pos[0] * y + pos[1]];
+            if (c == CELL_EMPTY) continue;
+            out->hash ^= sim_hash_cell(out, pos, c);
+            occupancy_mark(out, pos, true);
+        }
+    }
+
+    return out;
+
+}
+
+
+/**
+ * Safely 'delete' a simulation struct
+ * Frees all inhabitants, then cleans up and frees itself
+ * @param sim The simulation to be freed
+ * @return Success
+ */
+bool free_simulation(simulation * sim) {
+
+    // Sim is free
+    if (sim == NULL) return true;
+
+    // Free the garden, the file keeps it if there is one
+    if (sim->file != NULL)
+        garden_file_close(sim->file, sim->round);
+    else if (sim->garden != NULL)
+        free(sim->garden - ((ptrdiff_t) sim->pad * sim->stride + sim->pad));
+
+    free(sim->row_population);
+    free(sim->occupied);
+
+    // Free the chunks
+    chunk_map_free(sim->chunks);
+
+
+    // Free config
+    free_config(sim->config);
+
+
+    // Stop the workers
+    engine_free(sim->engine);
+    series_close(sim->series);
+    heatmap_free(sim->heatmap);
+    cluster_log_close(sim->clusters);
+
+
+    // Free the sim
+    free(sim);
+
+#ifdef DEBUG
+    printf("FREED THE SIMULATION!\n");
+#endif
+    return true;
+
+}
+
+
+/**
+ * Replace the config of a simulation, freeing the old one
+ * Settings from the config that change how the garden is laid out are applied here
+ * @param sim The simulation
+ * @param config The new config, now owned by the simulation
+ */
+void sim_set_config(simulation * sim, CONFIG * config) {
+
+    free_config(sim->config);
+    sim->config = config;
+
+    sim->wrap = config->WRAP_AROUND;
+
+    // Powers of two can wrap with a mask instead of a modulo
+    bool pow2 = !(sim->x & (sim->x - 1)) && !(sim->y & (sim->y - 1));
+    sim->x_mask = pow2 ? sim->x - 1 : 0;
+    sim->y_mask = pow2 ? sim->y - 1 : 0;
+
+    // Walls as deep as the furthest any scan kernel looks, none when the edges wrap
+    if (sim->garden != NULL && sim->file == NULL && !sim->tiled) {
+        int pad = config->FROG_VISION_DISTANCE;
+        if (pad < 1) pad = 1;
+        if (pad > SCAN_KERNEL_MAX) pad = SCAN_KERNEL_MAX;
+        sim_pad_garden(sim, sim->wrap ? 0 : pad);
+    }
+
+}
+
+
+/**
+ * Checks if a given position is within the bounds of a simulation
+ * Every position is in bounds of a wrap-around garden
+ * @param sim The simulation
+ * @param coordinate The position
+ * @return if the position is within bounds
+ */
+bool in_bounds(simulation * sim, const int coordinate[2]) {
+
+    if (sim->wrap) return true;
+
+    // Checking x axis
+    if (coordinate[0] < 0 || coordinate[0] >= sim-> x) return false;
+    // Cheching y axis
+    if (coordinate[1] < 0 || coordinate[1] >= sim-> y) return false;
+
+    // Position is in-bounds
+    return true;
+}
+
+
+/**
+ * Checks if a position in a given simulation's "garden" is null
+ * @param sim Simulation pointer
+ * @param coordinate [X,Y] position
+ * @return if that position is EMPTY
+ */
+bool is_null(simulation * sim, const int coordinate[2]) {
+
+    int c[2] = {coordinate[0], coordinate[1]};
+
+    // If the new position is empty (or out of bounds) return true
+    return !sim_wrap(sim, c) || cell_at(sim, c) == CELL_EMPTY;
+
+}
+
+
+/**
+ * Move a position onto the garden, if the garden has wrap-around edges
+ * Positions in a normal garden are left alone
+ * @param sim The simulation
+ * @param coordinate The position, changed in place
+ * @return if the position is within bounds
+ */
+bool sim_wrap(simulation * sim, int coordinate[2]) {
+
+    if (!sim->wrap) return in_bounds(sim, coordinate);
+
+    if (sim->x_mask && sim->y_mask) {
+        coordinate[0] &= sim->x_mask;
+        coordinate[1] &= sim->y_mask;
+        return true;
+    }
+
+    // % keeps the sign, so add the size back on for negative positions
+    coordinate[0] = (coordinate[0] % sim->x + sim->x) % sim->x;
+    coordinate[1] = (coordinate[1] % sim->y + sim->y) % sim->y;
+    return true;
+
+}
+
+
+/**
+ * Count the inhabitants in a simulation
+ * @param sim The simulation
+ * @return The number of non-empty positions
+ */
+int sim_population(simulation * sim) {
+
+    int count = 0;
+
+    if (sim->row_population != NULL) {
+        for (int x = 0; x < sim->x; x++) count += sim->row_population[x];
+        return count;
+    }
+
+    garden_walk walk;
+    sim_walk_start(sim, &walk);
+    while (sim_walk_next(sim, &walk)) count++;
+    sim_walk_end(&walk);
+
+    return count;
+
+}
+
+
+/**
+ * Count what a simulation will hold once its round has settled, without settling it
+ * Each cell is settled the way sim_settle would, so ages and deaths come out the same
+ * @param sim The simulation
+ * @param out The counts
+ */
+void sim_census(simulation * sim, garden_census * out) {
+
+    garden_walk walk;
+
+    * out = (garden_census) {0, 0, 0, 0, 0, 0};
+
+    sim_walk_start(sim, &walk);
+    while (sim_walk_next(sim, &walk)) {
+        cell c = cell_settle(cell_at(sim, walk.pos));
+        int age = (int) (c >> CELL_AGE_SHIFT & CELL_AGE_MAX);
+
+        if (cell_dies(sim, c)) {
+            out->deaths++;
+            continue;
+        }
+
+        switch (CELL_TYPE(c)) {
+            case LETTUCE:
+                out->lettuce++;
+                break;
+            case SLUG:
+                if (age < sim->config->SLUG_MATURE_AGE) out->slugs++;
+                else out->mature_slugs++;
+                break;
+            case FROG:
+                if (age < sim->config->FROG_MATURE_AGE) out->frogs++;
+                else out->mature_frogs++;
+                break;
+            default:
+                break;
+        }
+    }
+    sim_walk_end(&walk);
+
+}
+
+
+/**
+ * Start walking over the inhabitants of a simulation
+ * Inhabitants are visited in row-major order and the walk can safely continue after
+ * inhabitants are added, moved or removed; each position is checked when it is reached
+ * @param sim The simulation
+ * @param walk The walk to set up, must be ended with sim_walk_end
+ */
+void sim_walk_start(simulation * sim, garden_walk * walk) {
+
+    walk->pos[0] = 0;
+    walk->pos[1] = -1;
+    walk->started = false;
+
+    walk->from[0] = 0;
+    walk->from[1] = 0;
+    walk->to[0] = sim->x;
+    walk->to[1] = sim->y;
+
+    walk->chunks = NULL;
+    walk->chunk_count = 0;
+    walk->band = 0;
+    walk->band_end = 0;
+    walk->current = 0;
+
+    // Chunks allocated later can only hold inhabitants that have already acted
+    if (sim->chunks != NULL) {
+        walk->chunks = chunk_map_sorted(sim->chunks);
+        walk->chunk_count = sim->chunks->count;
+    }
+
+}
+
+
+/**
+ * Start walking over the inhabitants in a rectangle of a dense garden, in row-major order
+ * @param sim The simulation, which mustn't be sparse
+ * @param walk The walk to set up, must be ended with sim_walk_end
+ * @param from The first row and column
+ * @param to The row and column after the last ones, clipped to the garden
+ */
+void sim_walk_area(simulation * sim, garden_walk * walk, const int from[2], const int to[2]) {
+
+    sim_walk_start(sim, walk);
+
+    walk->from[0] = from[0];
+    walk->from[1] = from[1];
+    walk->to[0] = to[0] < sim->x ? to[0] : sim->x;
+    walk->to[1] = to[1] < sim->y ? to[1] : sim->y;
+
+    walk->pos[0] = from[0];
+    walk->pos[1] = from[1] - 1;
+
+}
 
 
 /**
- * Create a simulation struct and return a pointer too it
- * Simulations are stored on the heap, so various functions are used to hide malloc/free -ing
- * @param x Dimension of the simulation
- * @param y Dimension of the simulation
- * @return A pointer to the simulation
+ * Find the chunks in the same row of chunks as walk->band and start at the first of them
+ * @param walk The walk
+ * @return false if there are no chunks left
  */
-simulation * create_simulation(const int x, const int y) {
+static bool sim_walk_band(garden_walk * walk) {
 
-    simulation * out = malloc(sizeof(simulation));
+    if (walk->band >= walk->chunk_count) return false;
 
-    out->x = x;
-    out->y = y;
+    walk->band_end = walk->band;
+    while (walk->band_end < walk->chunk_count &&
+           walk->chunks[walk->band_end]->cx == walk->chunks[walk->band]->cx)
+        walk->band_end++;
+
+    walk->current = walk->band;
+    walk->pos[0] = walk->chunks[walk->band]->cx << CHUNK_BITS;
+    walk->pos[1] = (walk->chunks[walk->band]->cy << CHUNK_BITS) - 1;
+
+    return true;
+
+}
 
-    out->garden = malloc(x * sizeof(inhabitant **));
-    for (int n = 0; n < x; n++) {
-        out->garden[n] = malloc(y * sizeof(inhabitant *));
+
+/**
+ * Move a walk on to the next inhabitant
+ * @param sim The simulation
+ * @param walk The walk
+ * @return false once every inhabitant has been visited, walk->pos is the inhabitant otherwise
+ */
+bool sim_walk_next(simulation * sim, garden_walk * walk) {
+
+    if (!walk->started) {
+        walk->started = true;
+        if (walk->from[0] >= walk->to[0] || walk->from[1] >= walk->to[1]) return false;
+        if (sim->chunks != NULL && !sim_walk_band(walk)) return false;
     }
-    for (int i = 0; i < x; i++) {
-        for (int j = 0; j < y; j++) {
-            out->garden[i][j] = NULL;
+
+    // Dense gardens, row by row. Rows with nothing left in them are skipped, nearly full
+    // rows are walked position by position and the rest from their occupancy bits
+    if (sim->chunks == NULL) {
+        for (;;) {
+            int x = walk->pos[0];
+
+            if (walk->pos[1] + 1 >= walk->to[1] || sim->row_population[x] == 0) {
+                walk->pos[1] = walk->from[1] - 1;
+                if (++walk->pos[0] >= walk->to[0]) return false;
+
+                // Stay ahead of the walk through a file-backed garden
+                if (sim->file != NULL && walk->pos[0] % GARDEN_FILE_READAHEAD == 0)
+                    garden_file_prefetch(sim->file, walk->pos[0] + GARDEN_FILE_READAHEAD, GARDEN_FILE_READAHEAD);
+                continue;
+            }
+
+            if (sim->occupied != NULL && (sim->y - sim->row_population[x]) * WALK_FULL_RATIO >= sim->y) {
+                walk->pos[1] = occupancy_next(sim, x, walk->pos[1] + 1, walk->to[1]);
+                if (walk->pos[1] < walk->to[1]) return true;
+                continue;
+            }
+
+            if (CELL_LOAD(sim->garden + garden_index(sim, x, ++walk->pos[1])) != CELL_EMPTY) return true;
         }
     }
 
+    // Sparse gardens, each row crosses every chunk in its band from left to right
+    for (;;) {
 
-    out->round = 0;
+        chunk * c = walk->chunks[walk->current];
+
+        // Straight to the next inhabitant along this row of the chunk, if there is one
+        int from = walk->pos[1] + 1 - (c->cy << CHUNK_BITS);
+        uint64_t ahead = from < CHUNK_SIZE ? c->occupied[walk->pos[0] & CHUNK_MASK] >> from << from : 0;
+        if (ahead) {
+            walk->pos[1] = (c->cy << CHUNK_BITS) + chunk_first_bit(ahead);
+            return true;
+        }
+
+        // Next chunk along the row, or back to the start of the band on the next row
+        if (++walk->current == walk->band_end) {
+            walk->current = walk->band;
+            walk->pos[0]++;
 
-    out->config = create_empty_config();
+            // Finished the band
+            if (walk->pos[0] >= ((c->cx + 1) << CHUNK_BITS) || walk->pos[0] >= sim->x) {
+                walk->band = walk->band_end;
+                if (!sim_walk_band(walk)) return false;
+                continue;
+            }
+        }
+
+        walk->pos[1] = (walk->chunks[walk->current]->cy << CHUNK_BITS) - 1;
+    }
 
-    // Setup pointer to hold char *
-    out->last_action_message = malloc(sizeof (char *));
+}
 
-    // This is a pointer to the char *, so dereference when malloc-ing
-    * (out->last_action_message) = malloc(sizeof (char) * 256);
-    * (out->last_action_message)[0] = '\000';
 
+/**
+ * Finish walking over a simulation
+ * @param walk The walk
+ */
+void sim_walk_end(garden_walk * walk) {
 
-    return out;
+    free(walk->chunks);
+    walk->chunks = NULL;
 
 }
 
 
 /**
- * Safely 'delete' a simulation struct
- * Frees all inhabitants, then cleans up and frees itself
- * @param sim The simulation to be freed
- * @return Success
+ * End the round for every inhabitant at once
+ * Everything that had its turn ages by a round and gets hungrier, and all the
+ * actioned_this_round and newborn flags are cleared. Settled cells hash the same as
+ * they did before, so only deaths change the state hash.
+ * Slugs and frogs that are now older than their lifespan die here, all together, so
+ * they are gone before the next round starts
+ * @param sim The simulation
  */
-bool free_simulation(simulation * sim) {
+void sim_settle(simulation * sim) {
+
+    // Tile by tile, walls are left as they are
+    if (sim->tiled) {
+        for (int x = 0; x < sim->x; x += TILE_SIZE)
+            for (int y = 0; y < sim->y; y += TILE_SIZE)
+                settle_cells(sim, sim->garden + garden_index(sim, x, y), TILE_SIZE * TILE_SIZE, (int[2]) {x, y},
+                             TILE_SIZE);
+        return;
+    }
 
-    // Sim is free
-    if (sim == NULL) return true;
+    if (sim->chunks == NULL) {
+        sim_settle_rows(sim, 0, sim->x);
+        return;
+    }
 
-    // Free everything within the sim
-    for (int x = 0; x < sim->x; x++) {
-        for (int y = 0; y < sim->y; y++) {
-#ifdef DEBUG
-            printf("checking to free %d,%d \n", x, y);
-#endif
-#ifdef DEBUG
-            if (sim->garden[x][y] != NULL)
-                printf("Freed %d at %d, %d\n", sim->garden[x][y]->inhabitant_type, x, y);
-#endif
-            free_inhabitant(sim->garden[x][y]);
+    // Only the rows of each chunk that have something in them
+    for (int n = 0; n < sim->chunks->capacity; n++) {
+        chunk * c = sim->chunks->slots[n];
+        if (c == NULL) continue;
+
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            if (!c->occupied[x]) continue;
+
+            int origin[2] = {(c->cx << CHUNK_BITS) + x, c->cy << CHUNK_BITS};
+            int deaths = settle_cells(sim, c->cells[x], CHUNK_SIZE, origin, CHUNK_SIZE);
+            if (!deaths) continue;
+
+            c->population -= deaths;
+            for (int y = 0; y < CHUNK_SIZE; y++)
+                if (c->cells[x][y] == CELL_EMPTY) c->occupied[x] &= ~((uint64_t) 1 << y);
         }
     }
 
-    // Free the rows
-    for (int n = 0; n < sim->x; n++)
-        free(sim->garden[n]);
-    // Free the columns
-    free(sim->garden);
+}
 
 
-    // Free config
-    free_config(sim->config);
+/**
+ * Settle some of the rows of a dense garden that isn't tiled, see sim_settle
+ * @param sim The simulation
+ * @param from The first row
+ * @param to The row after the last one
+ */
+void sim_settle_rows(simulation * sim, const int from, const int to) {
 
+    // One row at a time, so the walls between rows are left alone
+    for (int x = from; x < to; x++)
+        settle_cells(sim, sim->garden + (ptrdiff_t) x * sim->stride, sim->y, (int[2]) {x, 0}, sim->y);
 
-    // Free action message
-    free(*(sim->last_action_message));
-    free(sim->last_action_message);
+}
 
 
-    // Free the sim
-    free(sim);
+/**
+ * Copy some of the rows of a dense garden out, one after another with nothing between them
+ * @param sim The simulation
+ * @param from The first row
+ * @param to The row after the last one
+ * @param out Room for (to - from) * y cells
+ */
+void sim_get_rows(simulation * sim, const int from, const int to, cell * out) {
 
-#ifdef DEBUG
-    printf("FREED THE SIMULATION!\n");
-#endif
-    return true;
+    for (int x = from; x < to; x++)
+        for (int y = 0; y < sim->y; y++)
+            * out++ = sim->garden[garden_index(sim, x, y)];
 
 }
 
 
 /**
- * Checks if a given position is within the bounds of a simulation
+ * Overwrite some of the rows of a dense garden, keeping the hash and occupancy up to date
  * @param sim The simulation
- * @param coordinate The position
- * @return if the position is within bounds
+ * @param from The first row
+ * @param to The row after the last one
+ * @param rows (to - from) * y cells, as from sim_get_rows
  */
-bool in_bounds(simulation * sim, const int coordinate[2]) {
-
-    // Checking x axis
-    if (coordinate[0] < 0 || coordinate[0] >= sim-> x) return false;
-    // Cheching y axis
-    if (coordinate[1] < 0 || coordinate[1] >= sim-> y) return false;
+void sim_put_rows(simulation * sim, const int from, const int to, const cell * rows) {
+
+    for (int pos[2] = {from, 0}; pos[0] < to; pos[0]++)
+        for (pos[1] = 0; pos[1] < sim->y; pos[1]++) {
+            cell * at = sim->garden + garden_index(sim, pos[0], pos[1]);
+            cell new = * rows++;
+            if (* at == new) continue;
+
+            sim->hash ^= sim_hash_cell(sim, pos, * at);
+            sim->hash ^= sim_hash_cell(sim, pos, new);
+            if ((* at == CELL_EMPTY) != (new == CELL_EMPTY)) occupancy_mark(sim, pos, new != CELL_EMPTY);
+            * at = new;
+        }
 
-    // Position is in-bounds
-    return true;
 }
 
 
 /**
- * Checks if a position in a given simulation's "garden" is null
- * @param sim Simulation pointer
- * @param coordinate [X,Y] position
- * @return if that position == NULL
+ * Free every chunk of a sparse garden that no longer has anything in it
+ * Done between rounds, so no walk is ever left holding a freed chunk
+ * @param sim The simulation
  */
-bool is_null(simulation * sim, const int coordinate[2]) {
+void sim_trim(simulation * sim) {
 
-    if (!in_bounds(sim, coordinate)) return true;
+    if (sim->chunks == NULL) return;
 
-    // If the new position is null return true
-    return sim->garden[coordinate[0]][coordinate[1]] == NULL;
+    chunk ** chunks = chunk_map_sorted(sim->chunks);
+    int count = sim->chunks->count;
+
+    for (int n = 0; n < count; n++)
+        if (chunks[n]->population == 0)
+            chunk_map_remove(sim->chunks, chunks[n]->cx, chunks[n]->cy);
+
+    free(chunks);
 
 }
 
@@ -139,129 +1117,509 @@ bool is_null(simulation * sim, const int coordinate[2]) {
  * Get the inhabitant in a sim at given coords
  * @param sim The simulation
  * @param coordinate The coordinates
- * @return Inhabitant * if one exists in bounds
+ * @return A copy of the inhabitant, EMPTY if there isn't one or it's out of bounds
+ */
+inhabitant sim_get(simulation * sim, const int coordinate[2]) {
+
+    int c[2] = {coordinate[0], coordinate[1]};
+    if (!sim_wrap(sim, c)) return create_inhabitant(EMPTY, 0, STATIONARY);
+
+    return cell_unpack(cell_at(sim, c));
+
+
+}
+
+
+/**
+ * Set the inhabitant in the garden if in bounds
+ * @param sim The simulation
+ * @param coordinate The coordinates
+ * @param i The new inhabitant, copied into the garden. EMPTY clears the position
+ * @return Success
  */
-inhabitant * sim_get(simulation * sim, const int coordinate[2]) {
+bool sim_set(simulation * sim, const int coordinate[2], inhabitant i) {
+
+    int c[2] = {coordinate[0], coordinate[1]};
+    if (!sim_wrap(sim, c)) return false;
+
+    cell old = cell_at(sim, c);
+    cell new = cell_pack(i);
 
-    if (!in_bounds(sim, coordinate)) return NULL;
+    // The busy bit of an inhabitant's own cell in an async round isn't part of it, and is let go here
+    if (CELL_IS_BUSY(old)) old &= ~CELL_BUSY;
 
-    return sim->garden[coordinate[0]][coordinate[1]];
+    // Swap the old occupant's hash for the new one's
+    sim->hash ^= sim_hash_cell(sim, c, old);
+    sim->hash ^= sim_hash_cell(sim, c, new);
 
+    bool was_empty = old == CELL_EMPTY;
+    bool is_empty = new == CELL_EMPTY;
+
+    if (sim->chunks == NULL) {
+        CELL_STORE(sim->garden + garden_index(sim, c[0], c[1]), new);
+        if (was_empty != is_empty) occupancy_mark(sim, c, !is_empty);
+        return true;
+    }
+
+    // Nothing to store, and no chunk to store it in
+    if (was_empty && is_empty) return true;
+
+    // Chunks are made on demand, emptied ones are left for sim_trim
+    chunk * ch = chunk_map_make(sim->chunks, c[0] >> CHUNK_BITS, c[1] >> CHUNK_BITS);
+    ch->population += was_empty - is_empty;
+    ch->cells[c[0] & CHUNK_MASK][c[1] & CHUNK_MASK] = new;
+    if (is_empty)
+        ch->occupied[c[0] & CHUNK_MASK] &= ~((uint64_t) 1 << (c[1] & CHUNK_MASK));
+    else
+        ch->occupied[c[0] & CHUNK_MASK] |= (uint64_t) 1 << (c[1] & CHUNK_MASK);
+    return true;
 
 }
 
 
 /**
- * Set the value of a pointer in the garden if in bounds
+ * Change the inhabitant in its own cell partway through its turn
+ * In an async round the cell stays busy, unlike with sim_set, so nothing can move in or eat
+ * it until the turn is written back
  * @param sim The simulation
  * @param coordinate The coordinates
- * @param i The new inhabitant value
+ * @param i The inhabitant, the same type as the one there
  * @return Success
  */
-bool sim_set(simulation * sim, const int coordinate[2], inhabitant * i) {
+bool sim_update(simulation * sim, const int coordinate[2], inhabitant i) {
 
-    if (!in_bounds(sim, coordinate)) return false;
+    int c[2] = {coordinate[0], coordinate[1]};
+    if (!sim->async || !sim_wrap(sim, c)) return sim_set(sim, coordinate, i);
 
-    sim->garden[coordinate[0]][coordinate[1]] = i;
+    cell * at = sim->garden + garden_index(sim, c[0], c[1]);
+    cell old = CELL_LOAD(at);
+    cell new = cell_pack(i);
+
+    bool busy = CELL_IS_BUSY(old);
+
+    sim->hash ^= sim_hash_cell(sim, c, busy ? old & ~CELL_BUSY : old);
+    sim->hash ^= sim_hash_cell(sim, c, new);
+
+    CELL_STORE(at, busy && new & CELL_TYPE_MASK ? new | CELL_BUSY : new);
     return true;
 
 }
 
 
 /**
- * Finds all inhabitants of a given type in a sim within a radius.
- * Does not include inhabitant at 'pos'
+ * Put an inhabitant somewhere, as long as what is there is still what was seen
+ * Moving, eating and breeding go through here, so in an async round whoever gets to a cell
+ * second fails and stays where they are. On one thread what was seen is always still there
  * @param sim The simulation
- * @param type Desired type
- * @param pos Initial position to search around
- * @param radius Distance around pos to look; Radius 0 will only consider pos
- * @return The linked list of relevant coordinates
+ * @param coordinate The coordinates
+ * @param expected The cell that is meant to be there
+ * @param i The new inhabitant
+ * @param claim Keep the cell busy in an async round, for an inhabitant that moves there
+ *              and will be written back at the end of its turn
+ * @return If the inhabitant was put there
  */
-coord_ll * find_all(simulation * sim, INHABITANT_TYPE type, const int pos[2], int radius) {
+bool sim_take(simulation * sim, const int coordinate[2], cell expected, inhabitant i, const bool claim) {
 
-    int _coord[2];
-    inhabitant * i;
+    int c[2] = {coordinate[0], coordinate[1]};
+    if (!sim_wrap(sim, c)) return false;
 
-    // Initialise the linked list
-    coord_ll * out = coord_ll_init();
+    // Someone else is in the middle of their turn there
+    if (CELL_IS_BUSY(expected)) return false;
 
-    // Check all within radius
-    for (int x = pos[0] - radius; x < pos[0] + radius + 1; x++) {
-        for (int y = pos[1] - radius; y < pos[1] + radius + 1; y++) {
+    if (sim->chunks != NULL) {
+        if (cell_at(sim, c) != expected) return false;
+        return sim_set(sim, c, i);
+    }
 
-            if (x == pos[0] && y == pos[1]) continue;
+    // Only an inhabitant can be claimed, an empty cell with the bit set would be a wall
+    cell new = cell_pack(i);
+    cell stored = claim && sim->async && new & CELL_TYPE_MASK ? new | CELL_BUSY : new;
+    if (!CELL_CAS(sim->garden + garden_index(sim, c[0], c[1]), &expected, stored))
+        return false;
 
-            _coord[0] = x;
-            _coord[1] = y;
+    sim->hash ^= sim_hash_cell(sim, c, expected);
+    sim->hash ^= sim_hash_cell(sim, c, new);
 
-            if (!in_bounds(sim, _coord)) continue;
+    if ((expected == CELL_EMPTY) != (new == CELL_EMPTY)) occupancy_mark(sim, c, new != CELL_EMPTY);
+    return true;
 
-            i = sim_get(sim, _coord);
+}
 
-            // If looking for free spaces
-            if (i == NULL) {
-                if (type == EMPTY)
-                    coord_ll_push(out, _coord);
-            } else {
-                // Check if types match requested
-                if (i->inhabitant_type == type)
-                    coord_ll_push(out, _coord);
-            }
 
+/**
+ * Claim an inhabitant's own cell at the start of its turn in an async round
+ * @param sim The simulation, which must be dense
+ * @param coordinate The coordinates, on the garden
+ * @return false if there is nothing there, it is busy or it has already had its turn
+ */
+bool sim_claim(simulation * sim, const int coordinate[2]) {
+
+    cell * at = sim->garden + garden_index(sim, coordinate[0], coordinate[1]);
+    cell seen = CELL_LOAD(at);
+
+    if (!(seen & CELL_TYPE_MASK) || CELL_IS_BUSY(seen) || seen & CELL_ACTIONED) return false;
+
+    return CELL_CAS(at, &seen, seen | CELL_BUSY);
+
+}
+
+
+/**
+ * Remove whatever is at a position in the garden
+ * @param sim The simulation
+ * @param coordinate The coordinates
+ * @return Success
+ */
+bool sim_clear(simulation * sim, const int coordinate[2]) {
+
+    return sim_set(sim, coordinate, create_inhabitant(EMPTY, 0, STATIONARY));
+
+}
+
+
+/**
+ * Zobrist hash of a single cell
+ * Each position has its own key, which is mixed with everything about the inhabitant
+ * that affects later rounds, as it will be once the round is settled
+ * Lettuce never read their age or hunger, and both grow until they saturate, so they are
+ * left out; otherwise a field of lettuce couldn't repeat until then
+ * @param sim The simulation
+ * @param coordinate The position of the cell
+ * @param c The cell
+ * @return The hash, 0 for an empty cell
+ */
+uint64_t sim_hash_cell(simulation * sim, const int coordinate[2], const cell c) {
+
+    if (c == CELL_EMPTY) return 0;
+
+    int pos[2] = {coordinate[0], coordinate[1]};
+    sim_wrap(sim, pos);
+
+    uint64_t key = mix64((uint64_t) pos[0] * (uint64_t) sim->y + (uint64_t) pos[1]);
+
+    cell kept = cell_settle(c);
+    if (CELL_TYPE(c) == LETTUCE) kept &= CELL_TYPE_MASK | CELL_MOVE_MASK << CELL_MOVE_SHIFT;
+
+    return mix64(key ^ kept);
+
+}
+
+
+/**
+ * Hash of the whole state of a simulation, including the random number generator
+ * and the countdowns to the next growth and reproduction
+ * If two rounds have the same state hash every round after them will match too
+ * @param sim The simulation
+ * @return The hash
+ */
+uint64_t sim_state_hash(simulation * sim) {
+
+    uint64_t rolls = mix64((uint64_t) sim->lettuce_grow.remaining);
+    rolls = mix64(rolls ^ (uint64_t) sim->slug_reproduce.remaining);
+    rolls = mix64(rolls ^ (uint64_t) sim->frog_reproduce.remaining);
+
+    return sim->hash ^ mix64(random_state(&sim->rng) ^ 0xD1B54A32D192ED03ULL) ^ rolls;
+
+}
+
+
+/**
+ * Count one cell into a neighbourhood, keeping it as the pick of any category it is in
+ * with the odds reservoir sampling gives, so each one counted is equally likely to be kept
+ * @param sim The simulation
+ * @param out The neighbourhood being scanned
+ * @param c The cell
+ * @param at The position of the cell, on the garden
+ * @param near If the cell is next door
+ * @param seen If the cell is within the radius
+ * @param type The type of the inhabitant scanning
+ * @param mature_age The age mates have to be
+ * @param roam If empty cells to move to are wanted
+ */
+static void scan_cell(simulation * sim, neighbourhood * out, const cell c, const int at[2], const bool near,
+                      const bool seen, const INHABITANT_TYPE type, const int mature_age, const bool roam) {
+
+    if (c == CELL_EMPTY) {
+        if (near && dice_roll(&sim->rng, ++out->space_count) == 0) {
+            out->space[0] = at[0];
+            out->space[1] = at[1];
         }
+        if (roam && seen && dice_roll(&sim->rng, ++out->roam_count) == 0) {
+            out->roam[0] = at[0];
+            out->roam[1] = at[1];
+        }
+        return;
     }
 
-    return out;
+    if (!seen) return;
+
+    if (CELL_TYPE(c) == type + 1) {
+        if (dice_roll(&sim->rng, ++out->food_count) == 0) {
+            out->food[0] = at[0];
+            out->food[1] = at[1];
+            out->food_cell = c;
+        }
+        return;
+    }
+
+    // Mates that have already had their turn this round are a round older than their cell says
+    if (CELL_TYPE(c) == type &&
+        (int) (c >> CELL_AGE_SHIFT & CELL_AGE_MAX) + ((c & (CELL_ACTIONED | CELL_NEWBORN)) == CELL_ACTIONED) >= mature_age)
+        out->mate_count++;
+
+}
 
+
+// Scan kernels for the usual vision radii, for windows that are entirely on the garden
+// The radius is fixed so the loops unroll, and nothing is bounds checked or wrapped.
+// base points at the inhabitant's cell and stride is the distance between rows
+#define SCAN_KERNEL(R) \
+static void scan_interior_##R(simulation * sim, neighbourhood * out, const cell * base, const ptrdiff_t stride, \
+                              const int home[2], const INHABITANT_TYPE type, const int mature_age, const bool roam) { \
+    int at[2]; \
+    for (int dx = -(R); dx <= (R); dx++) { \
+        at[0] = home[0] + dx; \
+        for (int dy = -(R); dy <= (R); dy++) { \
+            if (!dx && !dy) continue; \
+            at[1] = home[1] + dy; \
+            scan_cell(sim, out, CELL_LOAD(base + dx * stride + dy), at, abs(dx) <= 1 && abs(dy) <= 1, true, type, \
+                      mature_age, roam); \
+        } \
+    } \
 }
 
+SCAN_KERNEL(1)
+SCAN_KERNEL(2)
+SCAN_KERNEL(3)
+SCAN_KERNEL(4)
+
 
 /**
- * Finds all inhabitants of a given type in a sim adjacent to a point.
- * Does not include inhabitant at 'pos'
+ * Find the cells of a window that is entirely on the garden, for the scan kernels
  * @param sim The simulation
- * @param type Desired type
- * @param pos Initial position to search around
- * @return A linked list to all relevant coordinates
+ * @param home The middle of the window, on the garden
+ * @param reach How far the window goes out from home
+ * @param stride Set to the distance between rows
+ * @return The cell at home, NULL if the window isn't all in one block of cells
  */
-coord_ll * find_adjacent(simulation * sim, INHABITANT_TYPE type, const int pos[2]) {
+static const cell * scan_window(simulation * sim, const int home[2], const int reach, ptrdiff_t * stride) {
+
+    // Tiles aren't laid out in rows, see scan_tiles
+    if (sim->tiled) return NULL;
+
+    // Dense gardens can look into their border, whose walls are never empty, food or a mate
+    if (sim->chunks == NULL) {
+        int pad = sim->wrap ? 0 : sim->pad;
+        if (home[0] + pad < reach || home[0] + reach >= sim->x + pad ||
+            home[1] + pad < reach || home[1] + reach >= sim->y + pad) return NULL;
 
-    int _coord[2];
-    inhabitant * i;
+        * stride = sim->stride;
+        return sim->garden + (ptrdiff_t) home[0] * sim->stride + home[1];
+    }
+
+    if (home[0] < reach || home[0] + reach >= sim->x || home[1] < reach || home[1] + reach >= sim->y) return NULL;
+
+    // Sparse gardens only if the window is inside the inhabitant's own chunk
+    int x = home[0] & CHUNK_MASK;
+    int y = home[1] & CHUNK_MASK;
+    if (x < reach || x + reach >= CHUNK_SIZE || y < reach || y + reach >= CHUNK_SIZE) return NULL;
+
+    chunk * c = chunk_map_get(sim->chunks, home[0] >> CHUNK_BITS, home[1] >> CHUNK_BITS);
+    if (c == NULL) return NULL;
 
-    // Initialise the linked list
-    coord_ll * out = coord_ll_init();
+    * stride = CHUNK_SIZE;
+    return &c->cells[x][y];
+
+}
 
-    // Check all within radius
-    for (int x = pos[0] - 1; x < pos[0] + 2; x++) {
-        for (int y = pos[1] - 1; y < pos[1] + 2; y++) {
 
-            // Don't want corners
-            if (x != pos[0] && y != pos[1]) continue;
-            // Don't want the given pos
-            if (x == pos[0] && y == pos[1]) continue;
+/**
+ * Look at every cell of a window in a tiled garden, which may run into the ring of wall tiles
+ * Cells are looked at in the same order as the other scans, so the same things are picked
+ * @param sim The simulation
+ * @param out What was found
+ * @param home The middle of the window
+ * @param reach How far the window goes out from home, at most a tile
+ * @param radius How far the inhabitant can see
+ * @param type The type of the inhabitant
+ * @param mature_age The age mates have to be
+ * @param roam If empty cells to move to are wanted
+ */
+static void scan_tiles(simulation * sim, neighbourhood * out, const int home[2], const int reach, const int radius,
+                       const INHABITANT_TYPE type, const int mature_age, const bool roam) {
+
+    int at[2];
+    for (int dx = -reach; dx <= reach; dx++) {
+        at[0] = home[0] + dx;
+        for (int dy = -reach; dy <= reach; dy++) {
+            if (!dx && !dy) continue;
+            at[1] = home[1] + dy;
+            scan_cell(sim, out, CELL_LOAD(sim->garden + garden_index(sim, at[0], at[1])), at, abs(dx) <= 1 && abs(dy) <= 1,
+                      abs(dx) <= radius && abs(dy) <= radius, type, mature_age, roam);
+        }
+    }
 
-            _coord[0] = x;
-            _coord[1] = y;
+}
 
-            if (!in_bounds(sim, _coord)) continue;
 
-            i = sim_get(sim, _coord);
+/**
+ * Look at a window of a sparse garden, one chunk's part of a row at a time
+ * Empty cells only matter next door, or to roam into, so elsewhere only the cells the
+ * occupancy bits say are taken are looked at, and missing chunks are never looked at.
+ * Cells are still looked at in the same order as the other scans, so the same things are picked
+ * @param sim The simulation
+ * @param out What was found
+ * @param home The middle of the window
+ * @param reach How far the window goes out from home
+ * @param radius How far the inhabitant can see
+ * @param type The type of the inhabitant
+ * @param mature_age The age mates have to be
+ * @param roam If empty cells to move to are wanted
+ */
+static void scan_sparse(simulation * sim, neighbourhood * out, const int home[2], const int reach, const int radius,
+                        const INHABITANT_TYPE type, const int mature_age, const bool roam) {
+
+    int x_min = home[0] - reach > 0 ? home[0] - reach : 0;
+    int x_max = home[0] + reach < sim->x - 1 ? home[0] + reach : sim->x - 1;
+    int y_min = home[1] - reach > 0 ? home[1] - reach : 0;
+    int y_max = home[1] + reach < sim->y - 1 ? home[1] + reach : sim->y - 1;
+
+    int at[2];
+    for (at[0] = x_min; at[0] <= x_max; at[0]++) {
+        int dx = abs(at[0] - home[0]);
+
+        for (int y = y_min; y <= y_max;) {
+            int corner = y & ~CHUNK_MASK;
+            int end = corner + CHUNK_MASK < y_max ? corner + CHUNK_MASK : y_max;
+
+            // The columns of this chunk that are in the window
+            uint64_t span = (~(uint64_t) 0 >> (CHUNK_MASK - (end - corner))) & (~(uint64_t) 0 << (y - corner));
+
+            chunk * c = chunk_map_get(sim->chunks, at[0] >> CHUNK_BITS, y >> CHUNK_BITS);
+            uint64_t look = c != NULL ? c->occupied[at[0] & CHUNK_MASK] & span : 0;
+
+            if (roam) {
+                look = span;
+            } else if (dx <= 1) {
+                int near_min = home[1] - 1 > y ? home[1] - 1 : y;
+                int near_max = home[1] + 1 < end ? home[1] + 1 : end;
+                for (int n = near_min; n <= near_max; n++) look |= (uint64_t) 1 << (n - corner);
+            }
 
-            // If looking for free spaces
-            if (i == NULL) {
-                if (type == EMPTY)
-                    coord_ll_push(out, _coord);
-            } else {
-                // Check if types match requested
-                if (i->inhabitant_type == type)
-                    coord_ll_push(out, _coord);
+            for (; look; look &= look - 1) {
+                int b = chunk_first_bit(look);
+                at[1] = corner + b;
+                int dy = abs(at[1] - home[1]);
+                if (!dx && !dy) continue;
+                scan_cell(sim, out, c != NULL ? c->cells[at[0] & CHUNK_MASK][b] : CELL_EMPTY, at,
+                          dx <= 1 && dy <= 1, dx <= radius && dy <= radius, type, mature_age, roam);
             }
 
+            y = end + 1;
         }
     }
 
-    return out;
+}
+
+
+/**
+ * Look at everything around an inhabitant in one pass, for eat, breed and move_f to share
+ * Food and mates are looked for within the radius, places for a child next door, and places
+ * to move to within the radius if roam is set.
+ * Windows that are entirely on the garden go to a kernel for their radius. Others are
+ * clipped to the garden once, looked at tile by tile, or wrapped, rather than every cell being bounds checked
+ * @param sim The simulation
+ * @param pos The position of the inhabitant, which is never counted
+ * @param type The type of the inhabitant, food is the type below it in the food chain
+ * @param radius How far the inhabitant can see
+ * @param mature_age The age mates have to be
+ * @param roam If empty cells to move to are wanted
+ * @param out What was found
+ */
+void sim_scan(simulation * sim, const int pos[2], const INHABITANT_TYPE type, const int radius, const int mature_age,
+              const bool roam, neighbourhood * out) {
+
+    out->food_count = 0;
+    out->mate_count = 0;
+    out->space_count = 0;
+    out->roam_count = 0;
+
+    int home[2] = {pos[0], pos[1]};
+    if (!sim_wrap(sim, home)) return;
+
+    // Children go next door, even if the parent can't see that far
+    int reach = radius > 1 ? radius : 1;
+    int at[2];
+
+    ptrdiff_t stride;
+    const cell * base = radius >= 1 && radius <= SCAN_KERNEL_MAX ? scan_window(sim, home, reach, &stride) : NULL;
+
+    if (base != NULL) {
+        switch (radius) {
+            case 1:
+                scan_interior_1(sim, out, base, stride, home, type, mature_age, roam);
+                return;
+            case 2:
+                scan_interior_2(sim, out, base, stride, home, type, mature_age, roam);
+                return;
+            case 3:
+                scan_interior_3(sim, out, base, stride, home, type, mature_age, roam);
+                return;
+            default:
+                scan_interior_4(sim, out, base, stride, home, type, mature_age, roam);
+                return;
+        }
+    }
+
+    if (sim->chunks != NULL && !sim->wrap) {
+        scan_sparse(sim, out, home, reach, radius, type, mature_age, roam);
+        return;
+    }
+
+    if (sim->tiled && !sim->wrap && reach <= TILE_SIZE) {
+        scan_tiles(sim, out, home, reach, radius, type, mature_age, roam);
+        return;
+    }
+
+    if (!sim->wrap) {
+        int x_min = home[0] - reach > 0 ? home[0] - reach : 0;
+        int x_max = home[0] + reach < sim->x - 1 ? home[0] + reach : sim->x - 1;
+        int y_min = home[1] - reach > 0 ? home[1] - reach : 0;
+        int y_max = home[1] + reach < sim->y - 1 ? home[1] + reach : sim->y - 1;
+
+        for (at[0] = x_min; at[0] <= x_max; at[0]++) {
+            int dx = abs(at[0] - home[0]);
+            for (at[1] = y_min; at[1] <= y_max; at[1]++) {
+                int dy = abs(at[1] - home[1]);
+                if (!dx && !dy) continue;
+                scan_cell(sim, out, cell_at(sim, at), at, dx <= 1 && dy <= 1, dx <= radius && dy <= radius,
+                          type, mature_age, roam);
+            }
+        }
+        return;
+    }
+
+    // Wrap-around, at most one lap of the garden on each axis so nothing is counted twice
+    int x_span = 2 * reach + 1 < sim->x ? 2 * reach + 1 : sim->x;
+    int y_span = 2 * reach + 1 < sim->y ? 2 * reach + 1 : sim->y;
+
+    for (int i = 0; i < x_span; i++) {
+        // Distance the short way round
+        int dx = abs(i - reach);
+        if (sim->x - dx < dx) dx = sim->x - dx;
+
+        for (int j = 0; j < y_span; j++) {
+            int dy = abs(j - reach);
+            if (sim->y - dy < dy) dy = sim->y - dy;
+            if (!dx && !dy) continue;
+
+            at[0] = home[0] + i - reach;
+            at[1] = home[1] + j - reach;
+            sim_wrap(sim, at);
+            scan_cell(sim, out, cell_at(sim, at), at, dx <= 1 && dy <= 1, dx <= radius && dy <= radius,
+                      type, mature_age, roam);
+        }
+    }
 
 }
 
@@ -273,7 +1631,7 @@ coord_ll * find_adjacent(simulation * sim, INHABITANT_TYPE type, const int pos[2
 void pretty_print(simulation * sim) {
 
     char * c_temp;
-    inhabitant * i_temp;
+    inhabitant i_temp;
 
     // Print the config name
     if (sim->config != NULL)
@@ -293,18 +1651,18 @@ void pretty_print(simulation * sim) {
             c_temp = " ";
             i_temp = sim_get(sim, (int[2]) {x,y});
 
-            if (i_temp != NULL) {
-                switch (i_temp->inhabitant_type) {
+            if (i_temp.inhabitant_type != EMPTY) {
+                switch (i_temp.inhabitant_type) {
                     case LETTUCE:
                         c_temp = "0";
                         break;
                     case SLUG:
                         // Display as different characters depending on maturity
-                        c_temp = i_temp->age < sim->config->SLUG_MATURE_AGE ? "s" : "S";
+                        c_temp = i_temp.age < sim->config->SLUG_MATURE_AGE ? "s" : "S";
                         break;
                     case FROG:
                         // Same here
-                        c_temp = i_temp->age < sim->config->FROG_MATURE_AGE ? "f" : "F";
+                        c_temp = i_temp.age < sim->config->FROG_MATURE_AGE ? "f" : "F";
                         break;
                     default:
                         // Something has gone fatally wrong
@@ -321,7 +1679,8 @@ void pretty_print(simulation * sim) {
 
 
 /**
- * Update the last action message of a simulation to reflect the last action
+ * Record the last action in a simulation, for print_last_action_message
+ * Nothing is formatted here, as only the step by step mode ever prints it
  * First 4 args must not be null
  * @param sim The simulation the action is performed in
  * @param i1 The inhabitant performing the action
@@ -336,51 +1695,73 @@ void update_action_message(simulation * sim, inhabitant * i1, const int coord[2]
     if (i1 == NULL) return;
     if (coord == NULL) return;
 
-    free(* (sim->last_action_message));
-    * (sim->last_action_message) = malloc(sizeof (char) * 256);
+    action_record * out = &sim->last_action;
+
+    out->set = true;
+    out->action = action;
+    out->actor = * i1;
+    out->at[0] = coord[0];
+    out->at[1] = coord[1];
+
+    out->has_recipient = i2 != NULL;
+    if (i2 != NULL) out->recipient = * i2;
+
+    out->has_target = target != NULL;
+    if (target != NULL) {
+        out->target[0] = target[0];
+        out->target[1] = target[1];
+    }
+
+}
+
+
+/**
+ * Print the last action message of a simulation to terminal
+ * @param sim The simulation
+ */
+void print_last_action_message(simulation * sim) {
+
+    const action_record * last = &sim->last_action;
+    if (!last->set) {
+        printf("\n\n");
+        return;
+    }
 
-    // Max string length 255 + \000
-    char *out = malloc(sizeof(char) * 256);
     // Used to store ints in string format, length 4 + \000
     char i_temp1[5];
     char i_temp2[5];
 
     char t1[8] = "";
     char t2[32] = "";
-    if (i1 != NULL)
-        switch (i1->inhabitant_type) {
-            case LETTUCE:
-                sprintf(t1, "LETTUCE");
-                break;
-            case FROG:
-                sprintf(t1, "FROG");
-
-                snprintf(i_temp1, 4, "%d", i1->age);
-                snprintf(i_temp2, 4, "%d", i1->hunger);
-                sprintf(t2, "[age %s, hunger %s]", i_temp1, i_temp2);
-                break;
-            case SLUG:
-                sprintf(t1, "SLUG");
+    switch (last->actor.inhabitant_type) {
+        case LETTUCE:
+            sprintf(t1, "LETTUCE");
+            break;
+        case FROG:
+            sprintf(t1, "FROG");
 
-                snprintf(i_temp1, 4, "%d", i1->age);
-                sprintf(t2, "[age %s]", i_temp1);
-                break;
-            default:
-                sprintf(t1, "ERROR!");
-        }
+            snprintf(i_temp1, 4, "%d", last->actor.age);
+            snprintf(i_temp2, 4, "%d", last->actor.hunger);
+            sprintf(t2, "[age %s, hunger %s]", i_temp1, i_temp2);
+            break;
+        case SLUG:
+            sprintf(t1, "SLUG");
 
-    //printf("%s\000", t2);
+            snprintf(i_temp1, 4, "%d", last->actor.age);
+            sprintf(t2, "[age %s]", i_temp1);
+            break;
+        default:
+            sprintf(t1, "ERROR!");
+    }
 
     char t3[16] = "";
-    if (coord != NULL) {
-        snprintf(i_temp1, 4, "%d", coord[0]);
-        snprintf(i_temp2, 4, "%d", coord[1]);
-        sprintf(t3, "at (%s, %s)", i_temp1, i_temp2);
-    }
+    snprintf(i_temp1, 4, "%d", last->at[0]);
+    snprintf(i_temp2, 4, "%d", last->at[1]);
+    sprintf(t3, "at (%s, %s)", i_temp1, i_temp2);
 
 
     char t4[40] = "";
-    switch (action) {
+    switch (last->action) {
         case NOTHING:
             sprintf(t4, "did nothing");
             break;
@@ -405,8 +1786,8 @@ void update_action_message(simulation * sim, inhabitant * i1, const int coord[2]
     }
 
     char t5[16] = "";
-    if (i2 != NULL)
-        switch (i2->inhabitant_type) {
+    if (last->has_recipient)
+        switch (last->recipient.inhabitant_type) {
             case LETTUCE:
                 sprintf(t5, "LETTUCE at");
                 break;
@@ -421,28 +1802,11 @@ void update_action_message(simulation * sim, inhabitant * i1, const int coord[2]
         }
 
     char t6[16] = "";
-    if (target != NULL) {
-        snprintf(i_temp1, 4, "%d", target[0]);
-        snprintf(i_temp2, 4, "%d", target[1]);
+    if (last->has_target) {
+        snprintf(i_temp1, 4, "%d", last->target[0]);
+        snprintf(i_temp2, 4, "%d", last->target[1]);
         sprintf(t6, "(%s, %s)", i_temp1, i_temp2);
     }
 
-    snprintf(out, 256, "%s%s %s %s%s %s", t1, t2, t3, t4, t5, t6);
-    // Copy to last message
-    snprintf(*(sim->last_action_message), 256, "%s%s %s %s%s %s", t1, t2, t3, t4, t5, t6);
-
-    //printf("---> %s <---\n", last_action_message);
-
-}
-
-
-/**
- * Print the last action message of a simulation to terminal
- * @param sim The simulation
- */
-void print_last_action_message(simulation * sim) {
-
-    if (sim->last_action_message == NULL) return;
-    if (* (sim->last_action_message) == NULL) return;
-    printf("%s\n\n", * (sim->last_action_message));
+    printf("%s%s %s %s%s %s\n\n", t1, t2, t3, t4, t5, t6);
 }
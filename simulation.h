@@ -13,28 +13,81 @@
 #include <stdlib.h>
 
 #include "buildinfo.h"
+#include "chunk_map.h"
 #include "config.h"
+#include "garden_file.h"
 #include "utils.h"
 
 #include "global_enums.h"
 #include "global_structs.h"
 
 
+// Walks over every inhabitant of a simulation in row-major order
+// Sparse gardens only visit the chunks that were allocated when the walk started
+typedef struct {
+
+    int pos[2];
+    bool started;
+
+    // The rectangle [from, to) being walked, dense gardens can walk less than all of it
+    int from[2];
+    int to[2];
+
+    // Sparse gardens only
+    chunk ** chunks;
+    int chunk_count;
+    // Chunks [band, band_end) are the current row of chunks, current holds pos
+    int band;
+    int band_end;
+    int current;
+
+} garden_walk;
+
+
 // Creation
 simulation * create_simulation(int x, int y);
+simulation * create_sparse_simulation(int x, int y);
+simulation * create_tiled_simulation(int x, int y);
+simulation * create_mapped_simulation(int x, int y, const char * filename);
 bool free_simulation(simulation * sim);
+void sim_set_config(simulation * sim, CONFIG * config);
+size_t sim_garden_block(const simulation * sim, cell ** block);
+size_t sim_garden_offset(const simulation * sim, int x);
+void sim_move_garden(simulation * sim, cell * block);
 
 // Check functions
 bool in_bounds(simulation * sim, const int coordinate[2]);
 bool is_null(simulation * sim, const int coordinate[2]);
+bool sim_wrap(simulation * sim, int coordinate[2]);
+int sim_population(simulation * sim);
+void sim_census(simulation * sim, garden_census * out);
+
+// Walking over inhabitants
+void sim_walk_start(simulation * sim, garden_walk * walk);
+void sim_walk_area(simulation * sim, garden_walk * walk, const int from[2], const int to[2]);
+bool sim_walk_next(simulation * sim, garden_walk * walk);
+void sim_walk_end(garden_walk * walk);
+void sim_settle(simulation * sim);
+void sim_settle_rows(simulation * sim, int from, int to);
+void sim_get_rows(simulation * sim, int from, int to, cell * out);
+void sim_put_rows(simulation * sim, int from, int to, const cell * rows);
+void sim_trim(simulation * sim);
 
 // Encapsulated get and set
-inhabitant * sim_get(simulation * sim, const int coordinate[2]);
-bool sim_set(simulation * sim, const int coordinate[2], inhabitant * i);
-
-// coord_ll functions requiring sim
-coord_ll * find_all(simulation * sim, INHABITANT_TYPE type, const int pos[2], int radius);
-coord_ll * find_adjacent(simulation * sim, INHABITANT_TYPE type, const int pos[2]);
+inhabitant sim_get(simulation * sim, const int coordinate[2]);
+bool sim_set(simulation * sim, const int coordinate[2], inhabitant i);
+bool sim_clear(simulation * sim, const int coordinate[2]);
+bool sim_update(simulation * sim, const int coordinate[2], inhabitant i);
+bool sim_take(simulation * sim, const int coordinate[2], cell expected, inhabitant i, bool claim);
+bool sim_claim(simulation * sim, const int coordinate[2]);
+
+// State hashing
+uint64_t sim_hash_cell(simulation * sim, const int coordinate[2], cell c);
+uint64_t sim_state_hash(simulation * sim);
+
+// Neighbourhood scanning
+void sim_scan(simulation * sim, const int pos[2], INHABITANT_TYPE type, int radius, int mature_age,
+              bool roam, neighbourhood * out);
 
 // Printing functions
 void pretty_print(simulation * sim);
@@ -3,155 +3,13 @@
 //
 
 
-#include "utils.h"
-
-
-/**
- * Create a header pointer for a coord linked list
- * @return The pointer
- */
-coord_ll * coord_ll_init(void) {
-
-    coord_ll * out = malloc(sizeof(coord_ll));
-    out->values[0] = 0;
-    out->values[1] = 0;
-    out->ignore = true;
-    out->next = NULL;
-
-    return out;
-
-}
-
-
-/**
- * Create a new linked list struct
- * @param values The values to add
- * @return The pointer to the linked list struct
- */
-coord_ll * coord_ll_make(const int values[2]) {
-
-    coord_ll * out = malloc(sizeof(coord_ll));
-    out->values[0] = values[0];
-    out->values[1] = values[1];
-    out->ignore = false;
-    out->next = NULL;
-
-    return out;
-
-}
-
-
-/**
- * Get the coord_ll struct at a given index in a chain
- * @param head The start of the coord_ll chain
- * @param index The index to get
- * @return Pointer to the requested struct if it exists
- */
-coord_ll * coord_ll_get(coord_ll * head, const int index) {
-
-    if (index < 0) return NULL;
-    if (head == NULL) return NULL;
-
-    // I wanted to put these in ternary operators so here they are
-    // If we want to ignore the current value, recursive call with no change
-    return (head->ignore) ?
-           coord_ll_get(head->next, index) :
-           // Otherwise
-           // If index == 0, return this
-           // else decrement index by 1 and recurse
-           (!index) ?
-                    head :
-                    coord_ll_get(head->next, index - 1);
-
-}
-
-
-/**
- * Add a new value pair to the linked list struct chain
- * @param head Pointer to the start of the linked list
- * @param values The new values to be added
- */
-void coord_ll_push(coord_ll * head, const int values[2]) {
-
-    if (head->next == NULL) {
-
-        coord_ll * new = coord_ll_make(values);
-        head->next = new;
-        return;
-
-    }
-
-    coord_ll_push(head->next, values);
-
-}
-
+#include <math.h>
 
-/**
- * Remove a struct from a chain of coord_ll structs
- * @param head Start of the linked list chain
- * @param index The index to remove
- * @return Success
- */
-bool coord_ll_remove(coord_ll * head, const int index) {
-
-    if (index < 0) return false;
-    if (head == NULL) return false;
-
-    // Index == 0 but in a C way
-    if (!index) {
-        // These are nested to prevent NULL->NULL
-        if (head->next != NULL) {
-            if (head->next->next != NULL) {
-                coord_ll * temp = head->next;
-                head->next = head->next->next;
-                free(temp);
-                return true;
-
-            }
-
-            return false;
-        }
-
-        return false;
-
-    }
-
-    //                                      If we are ignoring values, don't decrement index
-    return coord_ll_remove(head->next, (head->ignore) ? index : index - 1);
-
-}
-
-
-/**
- * Free a whole linked list chain
- * @param head Pointer to the start of the chain
- */
-void coord_ll_free(coord_ll * head) {
-
-    if (head == NULL) return;
-
-    coord_ll_free(head->next);
-    free(head);
-
-}
-
-
-/**
- * Find the size of a linked list chain
- * @param head The start of the chain
- * @return Size of the list
- */
-int coord_ll_size(coord_ll * head) {
-
-    if (head == NULL) return 0;
-
-    // Here, the ternary operator seems unnecessary, but only the values of 'false' can be guaranteed
-    //  Despite stdbool defining false as 0 and true as 1, code such as
-    //  head->ignore = 3;
-    //  Will still compile and cause logic errors here
-    return ((head->ignore) ? 0 : 1) + coord_ll_size(head->next); // This feels very Haskell-eqsue
+#include "utils.h"
 
-}
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -227,40 +85,255 @@ void change_pos(int start_pos[2], DIRECTION dir) {
 }
 
 
+/**
+ * Seed a random number generator
+ * Each lane and word of the state is filled from the seed by splitmix64, so no lane
+ * starts all zero and the lanes don't overlap
+ * @param rng The generator
+ * @param seed The seed, any value is valid
+ */
+void random_seed(random_generator * rng, const uint64_t seed) {
+
+    uint64_t s = seed;
+
+    for (int w = 0; w < 4; w++)
+        for (int l = 0; l < RANDOM_LANES; l++) {
+            s += 0x9E3779B97F4A7C15ULL;
+            rng->state[w][l] = mix64(s);
+        }
+
+    // Empty, the first draw refills
+    rng->next = RANDOM_BUFFER;
+
+}
+
+
+/**
+ * Get a digest of the current state of a random number generator
+ * Two generators with the same digest will make the same rolls from here on.
+ * xoshiro steps are reversible, so the state after a refill also pins down what is
+ * left in the buffer
+ * @param rng The generator
+ * @return The digest
+ */
+uint64_t random_state(random_generator * rng) {
+
+    uint64_t out = (uint64_t) rng->next;
+
+    for (int w = 0; w < 4; w++)
+        for (int l = 0; l < RANDOM_LANES; l++)
+            out = mix64(out ^ rng->state[w][l]);
+
+    return out;
+
+}
+
+
+/**
+ * Scramble a 64 bit value so that every input bit affects every output bit
+ * This is the splitmix64 finaliser
+ * @param value The value to scramble
+ * @return The scrambled value
+ */
+uint64_t mix64(uint64_t value) {
+
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+
+}
+
+
+#if defined(__AVX2__)
+// Rotate every 64 bit lane left by k
+#define ROTL256(x, k) _mm256_or_si256(_mm256_slli_epi64((x), (k)), _mm256_srli_epi64((x), 64 - (k)))
+#endif
+
+
+/**
+ * Fill the buffer of a random number generator
+ * Every lane takes a xoshiro256** step for each group of RANDOM_LANES words. The
+ * multiplications by 5 and 9 are written as shifts and adds so the lanes vectorise
+ * even without a 64 bit vector multiply
+ * @param rng The generator
+ */
+static void random_refill(random_generator * rng) {
+
+#if defined(__AVX2__) && RANDOM_LANES == 4
+    __m256i s0 = _mm256_loadu_si256((__m256i *) rng->state[0]);
+    __m256i s1 = _mm256_loadu_si256((__m256i *) rng->state[1]);
+    __m256i s2 = _mm256_loadu_si256((__m256i *) rng->state[2]);
+    __m256i s3 = _mm256_loadu_si256((__m256i *) rng->state[3]);
+
+    for (int n = 0; n < RANDOM_BUFFER; n += RANDOM_LANES) {
+        // (s1 * 5) rotl 7 * 9
+        __m256i r = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+        r = ROTL256(r, 7);
+        r = _mm256_add_epi64(_mm256_slli_epi64(r, 3), r);
+        _mm256_storeu_si256((__m256i *) (rng->buffer + n), r);
+
+        __m256i t = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = ROTL256(s3, 45);
+    }
+
+    _mm256_storeu_si256((__m256i *) rng->state[0], s0);
+    _mm256_storeu_si256((__m256i *) rng->state[1], s1);
+    _mm256_storeu_si256((__m256i *) rng->state[2], s2);
+    _mm256_storeu_si256((__m256i *) rng->state[3], s3);
+#else
+    uint64_t * s0 = rng->state[0];
+    uint64_t * s1 = rng->state[1];
+    uint64_t * s2 = rng->state[2];
+    uint64_t * s3 = rng->state[3];
+
+    for (int n = 0; n < RANDOM_BUFFER; n += RANDOM_LANES) {
+        for (int l = 0; l < RANDOM_LANES; l++) {
+            uint64_t r = (s1[l] << 2) + s1[l];
+            r = r << 7 | r >> 57;
+            rng->buffer[n + l] = (r << 3) + r;
+
+            uint64_t t = s1[l] << 17;
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = s3[l] << 45 | s3[l] >> 19;
+        }
+    }
+#endif
+
+    rng->next = 0;
+
+}
+
+
+/**
+ * Take the next 64 random bits from a generator
+ * @param rng The generator
+ * @return 64 random bits
+ */
+static uint64_t random_next(random_generator * rng) {
+
+    if (rng->next == RANDOM_BUFFER) random_refill(rng);
+    return rng->buffer[rng->next++];
+
+}
+
+
+/**
+ * Take 64 random bits from a generator, for seeding other generators from it
+ * @param rng The generator
+ * @return 64 random bits
+ */
+uint64_t random_bits(random_generator * rng) {
+
+    return random_next(rng);
+
+}
+
+
+/**
+ * Draw a uniform double in [0, 1) from the top 53 bits of a random word
+ * @param rng The generator
+ * @return The double
+ */
+static double random_double(random_generator * rng) {
+
+    return (double) (random_next(rng) >> 11) * 0x1.0p-53;
+
+}
+
+
 /**
  * Roll a 'dice' with n sides, values 0 -> n - 1
+ * A dice with one side can only land one way, so nothing is drawn for it.
+ * Lemire's multiply and shift maps 32 random bits onto the sides without a division,
+ * and the rare draws that would favour some sides are thrown away, so it is unbiased
  *
  * The original random code, WHICH HAS BEEN MODIFIED, was provided by Neal
  * @authors Neal Snooke, Ben Snellgrove
+ * @param rng The generator
  * @param sides The amount of sides on the dice
  * @return The value of the dice
  */
-int dice_roll(const int sides) {
-    if (sides < 0) return 0;
-    if (sides == 0) return 0;
-    return ((rand() % sides));
+int dice_roll(random_generator * rng, const int sides) {
+    if (sides <= 1) return 0;
+
+    uint32_t range = (uint32_t) sides;
+    uint64_t m = (random_next(rng) >> 32) * range;
+
+    // Only possible when the low half lands below the range
+    if ((uint32_t) m < range) {
+        uint32_t threshold = -range % range;
+        while ((uint32_t) m < threshold)
+            m = (random_next(rng) >> 32) * range;
+    }
+
+    return (int) (m >> 32);
 }
 
 
 /**
- * Flip a weighted coin to determine whether or not an event will happen
- *
- * The original random code, WHICH HAS BEEN MODIFIED, was provided by Neal
- * @authors Neal Snooke, Ben Snellgrove
- * @param probability the weight of the coin
- * @return true/false
+ * Set up a skip counter so that its first roll draws a gap
+ * @param skip The counter
+ */
+void skip_counter_init(skip_counter * skip) {
+    skip->probability = 0.0;
+    skip->remaining = -1;
+}
+
+
+/**
+ * Flip a weighted coin to determine whether or not an event will happen, but only use the
+ * random number generator on a success
+ * The number of failures between successes of independent trials is geometric, so one draw
+ * gives the gap to the next success and the rolls in between just count it down.
+ * The odds of every roll are the same as flipping the coin each time.
+ * Certain outcomes (probability 0 or 1) don't draw from the generator, so gardens
+ * that never roll can settle into an exact cycle
+ * @param rng The generator
+ * @param skip The counter for this kind of event, every roll for it must go through here
+ * @param probability The probability of the event
+ * @return If the event occurs
  */
-bool event_roll(double probability) {
-    return probability > ((double) rand())/RAND_MAX;
+bool skip_roll(random_generator * rng, skip_counter * skip, double probability) {
+    if (probability <= 0.0) return false;
+    if (probability >= 1.0) return true;
+
+    // The gap drawn for a different probability doesn't apply
+    if (probability != skip->probability) {
+        skip->probability = probability;
+        skip->remaining = -1;
+    }
+
+    if (skip->remaining < 0) {
+        // Uniform in (0, 1], so the log is finite
+        double u = 1.0 - random_double(rng);
+        double gap = floor(log(u) / log1p(-probability));
+        skip->remaining = gap < 0x1.0p62 ? (int64_t) gap : INT64_C(1) << 62;
+    }
+
+    if (skip->remaining-- > 0) return false;
+
+    // Success, the next roll draws a new gap
+    skip->remaining = -1;
+    return true;
 }
 
 
 /**
  * Select a random bit from any that are 1 in an int
+ * @param rng The generator
  * @param options The bits to be selected from
  * @return An int with only that bit as 1
  */
-int pick_random_bit(int options) {
+int pick_random_bit(random_generator * rng, int options) {
 
 #ifdef DEBUG
     printf("OPTIONS are %d, ", options);
@@ -277,7 +350,7 @@ int pick_random_bit(int options) {
 #endif
     if (count == 1) return options;
 
-    int choose = dice_roll(count);
+    int choose = dice_roll(rng, count);
 
 #ifdef DEBUG
     printf("choose is %d, ", choose);
@@ -8,6 +8,7 @@
 
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -16,31 +17,45 @@
 #include "global_enums.h"
 
 
-// Coord_ll struct
-typedef struct COORD_LL {
+// Generators advanced side by side, so each step works on a whole vector of them
+#define RANDOM_LANES 4
+// Random words made by each refill
+#define RANDOM_BUFFER 64
 
-    int values[2];
-    bool ignore;
 
-    struct COORD_LL * next;
+// A random number generator, each simulation has its own
+// RANDOM_LANES xoshiro256** generators fill a buffer that draws are taken from
+typedef struct {
 
-} coord_ll;
+    // state[word][lane], so the same word of every lane is side by side
+    uint64_t state[4][RANDOM_LANES];
 
-// Coord_ll functions
-coord_ll * coord_ll_init(void);
-coord_ll * coord_ll_make(const int values[2]);
-coord_ll * coord_ll_get(coord_ll * head, int index);
-void coord_ll_push(coord_ll * head, const int values[2]);
-bool coord_ll_remove(coord_ll * head, int index);
-void coord_ll_free(coord_ll * head);
-int coord_ll_size(coord_ll * head);
+    uint64_t buffer[RANDOM_BUFFER];
+    // The next word to use, RANDOM_BUFFER once the buffer is used up
+    int next;
 
+} random_generator;
+
+
+// Countdown of failed trials until an event next happens, see skip_roll
+typedef struct {
+
+    double probability;
+    // Negative until the first gap has been drawn
+    int64_t remaining;
+
+} skip_counter;
 
 
 // Random functions
-int dice_roll(int sides);
-bool event_roll(double probability);
-int pick_random_bit(int options);
+void random_seed(random_generator * rng, uint64_t seed);
+uint64_t random_state(random_generator * rng);
+uint64_t random_bits(random_generator * rng);
+uint64_t mix64(uint64_t value);
+int dice_roll(random_generator * rng, int sides);
+void skip_counter_init(skip_counter * skip);
+bool skip_roll(random_generator * rng, skip_counter * skip, double probability);
+int pick_random_bit(random_generator * rng, int options);
 
 
 // Misc